@@ -0,0 +1,182 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "MyGUI.h"
+#include "ReactorModel.h"
+#include "ReactorGUI.h"
+#include "Plots.h"
+
+const double BENCH_MIN_SECONDS = 0.5;
+const int BENCH_MAX_ITERATIONS = 1000;
+const double BENCH_MOLECULE_SPACING = 10;
+const gm_dot<int, 2> BENCH_RECORDER_SZ = {400, 300};
+const unsigned BENCH_SEED = 42;
+
+struct BenchResult {
+    std::string name;
+    long long size;
+    int iterations;
+    double meanNS;
+    double minNS;
+};
+
+template <typename Func>
+static BenchResult runBench(const char *name, long long size, Func func) {
+    using Clock = std::chrono::steady_clock;
+
+    BenchResult result = {name, size, 0, 0, 0};
+    double totalNS = 0;
+    double minNS = std::numeric_limits<double>::max();
+
+    func(); // warm-up
+
+    while (result.iterations < BENCH_MAX_ITERATIONS && totalNS < BENCH_MIN_SECONDS * 1e9) {
+        Clock::time_point start = Clock::now();
+        func();
+        double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+
+        totalNS += ns;
+        minNS = std::min(minNS, ns);
+        result.iterations++;
+    }
+
+    result.meanNS = totalNS / result.iterations;
+    result.minNS = minNS;
+    return result;
+}
+
+static double boxSideFor(long long moleculesCount) {
+    return std::max(MIN_REACTOR_SIZE, std::sqrt((double) moleculesCount) * BENCH_MOLECULE_SPACING);
+}
+
+static BenchResult benchReactorUpdate(long long moleculesCount) {
+    double side = boxSideFor(moleculesCount);
+    ReactorModel model(side, side, [] {});
+
+    for (long long i = 0; i < moleculesCount; i++) {
+        if (i % 2) model.addQuadrit();
+        else       model.addCirclit();
+    }
+
+    return runBench("reactor_update", moleculesCount, [&model] { model.update(0.04); });
+}
+
+static BenchResult benchPrimitivesRebuild(SDL_Renderer *renderer, long long moleculesCount) {
+    double side = boxSideFor(moleculesCount);
+    std::mt19937 rng(BENCH_SEED);
+    std::uniform_real_distribution<double> coord(0, side);
+
+    ReactorSnapshot snapshot;
+    snapshot.molecules.reserve(moleculesCount);
+    for (long long i = 0; i < moleculesCount; i++) {
+        double x = coord(rng);
+        double y = coord(rng);
+        snapshot.molecules.push_back({x, y, x, y, 3, (i % 2 ? MoleculeTypes::QUADRIT : MoleculeTypes::CIRCLIT)});
+    }
+
+    ReactorCanvas canvas((int) side, (int) side, /*stepDelayMS*/ 1000);
+
+    // The first rebuild queues the molecule sprites; binding rasterizes them,
+    // so the timed runs take the sprite-quad path like a rendered frame does.
+    canvas.recalculateMoleculePrimitives(snapshot);
+    shapeSpriteCache().bind(renderer);
+
+    return runBench("primitives_rebuild", moleculesCount, [&canvas, &snapshot] { canvas.recalculateMoleculePrimitives(snapshot); });
+}
+
+static void addRecorderSample(RecorderWidget &recorder, int idx) {
+    recorder.record(idx, BENCH_RECORDER_SZ.y * 0.5 * (1 + std::sin(idx * 0.05)), BENCH_RECORDER_SZ.y * 0.5 * (1 + std::cos(idx * 0.05)));
+}
+
+static void addRecorderChannels(RecorderWidget &recorder) {
+    recorder.addChannel("sin", RED_SDL_COLOR);
+    recorder.addChannel("cos", BLUE_SDL_COLOR);
+}
+
+static BenchResult benchRecorderRender(SDL_Renderer *renderer) {
+    RecorderWidget recorder(BENCH_RECORDER_SZ.x, BENCH_RECORDER_SZ.y);
+    addRecorderChannels(recorder);
+    for (int i = 0; i < BENCH_RECORDER_SZ.x; i++) addRecorderSample(recorder, i);
+
+    // Changing the scale forces the whole plot to be redrawn.
+    return runBench("recorder_render", BENCH_RECORDER_SZ.x, [&recorder, renderer] {
+        recorder.setXScale(1);
+        recorder.renderSelfAction(renderer);
+    });
+}
+
+static BenchResult benchRecorderAppend(SDL_Renderer *renderer) {
+    RecorderWidget recorder(BENCH_RECORDER_SZ.x, BENCH_RECORDER_SZ.y);
+    addRecorderChannels(recorder);
+    int samplesCount = 0;
+    for (; samplesCount < BENCH_RECORDER_SZ.x; samplesCount++) addRecorderSample(recorder, samplesCount);
+
+    return runBench("recorder_append", BENCH_RECORDER_SZ.x, [&recorder, &samplesCount, renderer] {
+        addRecorderSample(recorder, samplesCount++);
+        recorder.renderSelfAction(renderer);
+    });
+}
+
+static std::vector<long long> parseSizes(const char *list) {
+    std::vector<long long> sizes;
+    for (const char *cur = list; *cur; ) {
+        char *end = nullptr;
+        long long size = strtoll(cur, &end, 10);
+        if (end == cur) break;
+        if (size > 0) sizes.push_back(size);
+        cur = (*end == ',' ? end + 1 : end);
+    }
+    return sizes;
+}
+
+static void printJSON(const std::vector<BenchResult> &results) {
+    printf("{\n  \"benchmarks\": [\n");
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult &result = results[i];
+        printf("    {\"name\": \"%s\", \"size\": %lld, \"iterations\": %d, \"mean_ns\": %.1f, \"min_ns\": %.1f}%s\n",
+            result.name.c_str(), result.size, result.iterations, result.meanNS, result.minNS,
+            (i + 1 < results.size() ? "," : ""));
+    }
+    printf("  ]\n}\n");
+}
+
+int main(int argc, char *argv[]) {
+    std::vector<long long> sizes = {1000, 10000, 100000, 1000000};
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--sizes") && i + 1 < argc) {
+            sizes = parseSizes(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [--sizes N1,N2,...]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<BenchResult> results;
+
+    for (long long size : sizes) results.push_back(benchReactorUpdate(size));
+    SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(0, BENCH_RECORDER_SZ.x, BENCH_RECORDER_SZ.y, 32, SDL_PIXELFORMAT_RGBA8888);
+    SDL_Renderer *renderer = (surface ? SDL_CreateSoftwareRenderer(surface) : nullptr);
+    if (!renderer) {
+        fprintf(stderr, "software renderer: %s\n", SDL_GetError());
+        return 1;
+    }
+
+    for (long long size : sizes) results.push_back(benchPrimitivesRebuild(renderer, size));
+    results.push_back(benchRecorderRender(renderer));
+    results.push_back(benchRecorderAppend(renderer));
+
+    releaseRenderResources();
+    SDL_DestroyRenderer(renderer);
+    SDL_FreeSurface(surface);
+
+    printJSON(results);
+    return 0;
+}
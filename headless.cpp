@@ -0,0 +1,151 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "ReactorModel.h"
+#include "RecorderHistory.h"
+
+struct HeadlessConfig {
+    int circlitCount = 100;
+    int quadritCount = 100;
+    double width = 300;
+    double height = 300;
+    double dt = 0.04;
+    long long steps = 1000;
+    long long recordEvery = 1;
+    const char *outputPath = nullptr;
+    bool binaryOutput = false;
+    const char *exportHistoryPath = nullptr;
+};
+
+struct HeadlessRecord {
+    long long step;
+    int circlitCount;
+    int quadritCount;
+    double summaryEnergy;
+    double wallsEnergy[4];
+};
+
+static const int WALLS_ORDER[4] = {LEFT_WALL, RIGHT_WALL, TOP_WALL, BOTTOM_WALL};
+
+static void printUsage(const char *programName) {
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  --circlits N       initial circlit count (default 100)\n"
+        "  --quadrits N       initial quadrit count (default 100)\n"
+        "  --width W          reactor width (default 300)\n"
+        "  --height H         reactor height (default 300)\n"
+        "  --dt SEC           simulation step in seconds (default 0.04)\n"
+        "  --steps N          number of steps (default 1000)\n"
+        "  --every N          record every N-th step (default 1)\n"
+        "  --output PATH      output file (default stdout)\n"
+        "  --binary           write fixed-size binary records instead of CSV\n"
+        "  --export-history HISTORY\n"
+        "                     convert a recorder history (.rch) to CSV at --output and exit\n",
+        programName);
+}
+
+static bool parseArgs(int argc, char *argv[], HeadlessConfig &config) {
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = (i + 1 < argc ? argv[i + 1] : nullptr);
+
+        if (!strcmp(arg, "--binary")) {
+            config.binaryOutput = true;
+            continue;
+        }
+        if (!strcmp(arg, "--help")) return false;
+        if (!value) {
+            fprintf(stderr, "missing value for %s\n", arg);
+            return false;
+        }
+
+        if      (!strcmp(arg, "--circlits")) config.circlitCount = atoi(value);
+        else if (!strcmp(arg, "--quadrits")) config.quadritCount = atoi(value);
+        else if (!strcmp(arg, "--width"))    config.width = atof(value);
+        else if (!strcmp(arg, "--height"))   config.height = atof(value);
+        else if (!strcmp(arg, "--dt"))       config.dt = atof(value);
+        else if (!strcmp(arg, "--steps"))    config.steps = atoll(value);
+        else if (!strcmp(arg, "--every"))    config.recordEvery = atoll(value);
+        else if (!strcmp(arg, "--output"))   config.outputPath = value;
+        else if (!strcmp(arg, "--export-history")) config.exportHistoryPath = value;
+        else {
+            fprintf(stderr, "unknown option %s\n", arg);
+            return false;
+        }
+        i++;
+    }
+
+    if (config.circlitCount < 0 || config.quadritCount < 0 || config.steps < 0 ||
+        config.recordEvery <= 0 || config.dt <= 0 || config.width <= 0 || config.height <= 0) {
+        fprintf(stderr, "invalid arguments\n");
+        return false;
+    }
+    if (config.exportHistoryPath && !config.outputPath) {
+        fprintf(stderr, "--export-history needs --output\n");
+        return false;
+    }
+
+    return true;
+}
+
+static HeadlessRecord makeRecord(ReactorModel &model, long long step) {
+    HeadlessRecord record = {};
+    record.step = step;
+    record.circlitCount = model.getCirclitCount();
+    record.quadritCount = model.getQuadritCount();
+    record.summaryEnergy = model.getSummaryEnergy();
+    for (int i = 0; i < 4; i++) {
+        record.wallsEnergy[i] = model.getReactorWalls()[WALLS_ORDER[i]].energy;
+    }
+    return record;
+}
+
+static void writeRecord(FILE *output, const HeadlessRecord &record, bool binaryOutput) {
+    if (binaryOutput) {
+        fwrite(&record, sizeof(record), 1, output);
+        return;
+    }
+
+    fprintf(output, "%lld,%d,%d,%.17g,%.17g,%.17g,%.17g,%.17g\n",
+        record.step, record.circlitCount, record.quadritCount, record.summaryEnergy,
+        record.wallsEnergy[0], record.wallsEnergy[1], record.wallsEnergy[2], record.wallsEnergy[3]);
+}
+
+int main(int argc, char *argv[]) {
+    HeadlessConfig config;
+    if (!parseArgs(argc, argv, config)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    if (config.exportHistoryPath) {
+        return (RecorderHistoryFile::exportCSV(config.exportHistoryPath, config.outputPath) ? 0 : 1);
+    }
+
+    FILE *output = stdout;
+    if (config.outputPath) {
+        output = fopen(config.outputPath, config.binaryOutput ? "wb" : "w");
+        if (!output) {
+            perror(config.outputPath);
+            return 1;
+        }
+    }
+
+    ReactorModel model(config.width, config.height, [] {});
+    for (int i = 0; i < config.circlitCount; i++) model.addCirclit();
+    for (int i = 0; i < config.quadritCount; i++) model.addQuadrit();
+
+    if (!config.binaryOutput) {
+        fprintf(output, "step,circlits,quadrits,summary_energy,left_wall,right_wall,top_wall,bottom_wall\n");
+    }
+    writeRecord(output, makeRecord(model, 0), config.binaryOutput);
+
+    for (long long step = 1; step <= config.steps; step++) {
+        model.update(config.dt);
+        if (step % config.recordEvery == 0) writeRecord(output, makeRecord(model, step), config.binaryOutput);
+    }
+
+    if (output != stdout) fclose(output);
+    return 0;
+}
@@ -1,8 +1,12 @@
 #ifndef CLOCK_WIDGET_H
 #define CLOCK_WIDGET_H
 
+#include <utility>
+
 #include "gm_primitives.hpp"
 #include "MyGUI.h"
+#include "LayerCache.h"
+#include "GlyphAtlas.h"
 
 
 class ClockWindow : public Window {
@@ -24,11 +28,10 @@ class ClockWindow : public Window {
 
     TTF_Font* font_ = nullptr;
 
-    SDL_Texture* topNumber_      = nullptr;
-    SDL_Texture* bottomNumber_   = nullptr;
-    SDL_Texture* leftNumber_     = nullptr;
-    SDL_Texture* rightNumber_    = nullptr;
-    SDL_Texture* dialTexture_    = nullptr;
+    GlyphAtlas numbersAtlas_;
+
+    StaticLayer dialLayer_;
+    DynamicOverlay<std::pair<int, int>> clockHandOverlay_;
 
 private:
     void drawClockMarks(SDL_Renderer* renderer) {
@@ -51,51 +54,15 @@ private:
         }
     }
 
-    void drawNumberTexture(SDL_Texture* texture, const gm_dot<int, 2> pos, SDL_Renderer* renderer) {
-        assert(texture);
-        assert(renderer);
-
-        SDL_Rect dstRect = {pos.x, pos.y, 0, 0};
-        SDL_QueryTexture(texture, NULL, NULL, &dstRect.w, &dstRect.h);
-
-        SDL_RenderCopy(renderer, texture, NULL, &dstRect);
-    
-    }
     void drawClockNumbers(SDL_Renderer* renderer) {
-        drawNumberTexture(topNumber_, {clockCenter_.x, clockCenter_.y - clockRadius_ - FONT_SIZE * 2}, renderer);
-        drawNumberTexture(bottomNumber_, {clockCenter_.x, clockCenter_.y + clockRadius_ + FONT_SIZE}, renderer);
-        drawNumberTexture(leftNumber_, {clockCenter_.x - clockRadius_ - FONT_SIZE * 2, clockCenter_.y}, renderer);
-        drawNumberTexture(rightNumber_, {clockCenter_.x + clockRadius_ + FONT_SIZE, clockCenter_.y}, renderer);
+        numbersAtlas_.queue(TOP_NUMBER_TEXT_, clockCenter_.x, clockCenter_.y - clockRadius_ - FONT_SIZE * 2, TEXT_COLOR);
+        numbersAtlas_.queue(BOTTOM_NUMBER_TEXT_, clockCenter_.x, clockCenter_.y + clockRadius_ + FONT_SIZE, TEXT_COLOR);
+        numbersAtlas_.queue(LEFT_NUMBER_TEXT_, clockCenter_.x - clockRadius_ - FONT_SIZE * 2, clockCenter_.y, TEXT_COLOR);
+        numbersAtlas_.queue(RIGHT_NUMBER_TEXT_, clockCenter_.x + clockRadius_ + FONT_SIZE, clockCenter_.y, TEXT_COLOR);
+        numbersAtlas_.flush(renderer);
     }
 
-    void initNumberTextures(SDL_Renderer* renderer) {
-        topNumber_      = createFontTexture(font_, TOP_NUMBER_TEXT_, FONT_SIZE, TEXT_COLOR, renderer);
-        bottomNumber_   = createFontTexture(font_, BOTTOM_NUMBER_TEXT_, FONT_SIZE, TEXT_COLOR, renderer);
-        leftNumber_     = createFontTexture(font_, LEFT_NUMBER_TEXT_, FONT_SIZE, TEXT_COLOR, renderer);
-        rightNumber_    = createFontTexture(font_, RIGHT_NUMBER_TEXT_, FONT_SIZE, TEXT_COLOR, renderer);
-
-        assert(topNumber_);
-        assert(bottomNumber_);
-        assert(leftNumber_);
-        assert(rightNumber_);
-    }
-
-    void initDialTexture(SDL_Renderer* renderer) {
-        dialTexture_ = SDL_CreateTexture(
-            renderer,
-            SDL_PIXELFORMAT_RGBA8888,
-            SDL_TEXTUREACCESS_TARGET,
-            length_,
-            length_
-        );
-
-        SDL_Texture* prevTarget = SDL_GetRenderTarget(renderer);
-        SDL_SetRenderTarget(renderer, dialTexture_);
-
-
-        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
-        SDL_RenderClear(renderer);
-
+    void drawDial(SDL_Renderer* renderer) {
         SDL_SetRenderDrawColor(renderer, DEFAULT_WINDOW_COLOR.r, DEFAULT_WINDOW_COLOR.g, DEFAULT_WINDOW_COLOR.b, DEFAULT_WINDOW_COLOR.a); 
         SDL_Rect full = {0, 0, rect_.w, rect_.h};
         SDL_RenderFillRect(renderer, &full);
@@ -105,25 +72,22 @@ private:
         circleColor(renderer, length_ / 2, length_ / 2, clockRadius_, SDL2gfxColorToUint32(BLACK_SDL_COLOR));
 
         drawClockMarks(renderer);
-
-        initNumberTextures(renderer);
         drawClockNumbers(renderer);
-
-        SDL_SetRenderTarget(renderer, prevTarget);
     }   
 
-    void drawClockHand(SDL_Renderer* renderer) {
+    std::pair<int, int> clockHandEnd() const {
         gm_vector<double, 2> clockHand = {0, -1};
         clockHand = clockHand * clockRadius_;
         clockHand = clockHand.rotate((double) currentTimeMS_ / (60 * SEC_TO_MS) * 2 * M_PI);
-    
-        double x1 = length_ / 2;
-        double y1 = length_ / 2;
-        double x2 = x1 + clockHand.get_x();
-        double y2 = y1 + clockHand.get_y();
+
+        return {(int) (length_ / 2 + clockHand.get_x()), (int) (length_ / 2 + clockHand.get_y())};
+    }
+
+    void drawClockHand(SDL_Renderer* renderer) {
+        std::pair<int, int> handEnd = clockHandEnd();
 
         SDL_SetRenderDrawColor(renderer, BLACK_SDL_COLOR.r, BLACK_SDL_COLOR.g, BLACK_SDL_COLOR.b, BLACK_SDL_COLOR.a);
-        SDL_RenderDrawLine(renderer, x1, y1, x2, y2);
+        SDL_RenderDrawLine(renderer, length_ / 2, length_ / 2, handEnd.first, handEnd.second);
     }
 
 public:
@@ -136,7 +100,7 @@ public:
             SDL_Log("TTF_OpenFont: %s", TTF_GetError());
             assert(0);
         }
-        
+        numbersAtlas_.build(font_);
     }
 
     ~ClockWindow() override { TTF_CloseFont(font_); }
@@ -145,23 +109,15 @@ public:
     void renderSelfAction(SDL_Renderer* renderer) override {
         assert(renderer);
     
-        static bool initDialTextureFlag = true;
-        
-        if (initDialTextureFlag) {
-            initDialTexture(renderer);
-            initDialTextureFlag = false;
-        }
-
-        SDL_Rect dst = {0, 0, length_, length_};
-        SDL_RenderCopy(renderer, dialTexture_, NULL, &dst);
-    
+        dialLayer_.draw(renderer, length_, length_, [this](SDL_Renderer* renderer) { drawDial(renderer); });
         drawClockHand(renderer);
     }
 
+    // Rerenders only when the hand tip moves to another pixel.
     void updateClock(double deltaMS) {
         currentTimeMS_ += deltaMS;
         if (currentTimeMS_ >= 60 * SEC_TO_MS) currentTimeMS_ = 0;
-        setRerenderFlag();
+        if (clockHandOverlay_.update(clockHandEnd())) setRerenderFlag();
     }
 };
 
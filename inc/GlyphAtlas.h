@@ -0,0 +1,211 @@
+#ifndef GLYPH_ATLAS_H
+#define GLYPH_ATLAS_H
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "MyGUI.h"
+#include "RenderResources.h"
+
+const int GLYPH_ATLAS_SIZE = 256;
+const int GLYPH_ATLAS_PADDING = 1;
+const char GLYPH_ATLAS_FIRST_CHAR = ' ';
+const char GLYPH_ATLAS_LAST_CHAR = '~';
+const char GLYPH_ATLAS_FALLBACK_CHAR = '?';
+const size_t GLYPH_ATLAS_SHAPED_CACHE_SIZE = 512;
+
+// A string laid out against the atlas: one textured quad per glyph, with
+// positions relative to the top-left corner of the text.
+struct ShapedText {
+    std::vector<SDL_Vertex> vertices = {};
+    int width = 0;
+    int height = 0;
+};
+
+// Printable ASCII of one TTF_Font (so one face and size) rasterized once into
+// a texture. Strings are shaped into quads once and cached; queued strings
+// are drawn together by flush() in a single SDL_RenderGeometry call. The
+// texture is uploaded again from the kept surface after a render reset.
+class GlyphAtlas : public RenderResource {
+    struct Glyph {
+        SDL_Rect src;
+        int advance;
+    };
+
+    SDL_Surface *pixels_ = nullptr;
+    Glyph glyphs_[GLYPH_ATLAS_LAST_CHAR - GLYPH_ATLAS_FIRST_CHAR + 1] = {};
+    int lineHeight_ = 0;
+
+    SDL_Renderer *renderer_ = nullptr;
+    SDL_Texture *texture_ = nullptr;
+
+    std::unordered_map<std::string, ShapedText> shaped_ = {};
+
+    std::vector<SDL_Vertex> batchVertices_ = {};
+    std::vector<int> batchIndices_ = {};
+
+private:
+    const Glyph &glyph(char ch) const {
+        if (ch < GLYPH_ATLAS_FIRST_CHAR || ch > GLYPH_ATLAS_LAST_CHAR) ch = GLYPH_ATLAS_FALLBACK_CHAR;
+        return glyphs_[ch - GLYPH_ATLAS_FIRST_CHAR];
+    }
+
+    bool bind(SDL_Renderer *renderer) {
+        assert(renderer);
+        if (!pixels_) return false;
+
+        if (renderer != renderer_) {
+            invalidate();
+            texture_ = SDL_CreateTextureFromSurface(renderer, pixels_);
+            if (!texture_) SDL_Log("GlyphAtlas texture: %s", SDL_GetError());
+            else           SDL_SetTextureBlendMode(texture_, SDL_BLENDMODE_BLEND);
+
+            renderer_ = renderer;
+        }
+
+        return texture_ != nullptr;
+    }
+
+public:
+    GlyphAtlas() = default;
+
+    ~GlyphAtlas() override {
+        invalidate();
+        if (pixels_) SDL_FreeSurface(pixels_);
+    }
+
+    // Rasterizes the glyphs in white; the text color is applied per vertex.
+    // The font is not kept and may be closed afterwards.
+    bool build(TTF_Font *font) {
+        assert(font);
+
+        if (pixels_) SDL_FreeSurface(pixels_);
+        pixels_ = SDL_CreateRGBSurfaceWithFormat(0, GLYPH_ATLAS_SIZE, GLYPH_ATLAS_SIZE, 32, SDL_PIXELFORMAT_ARGB8888);
+        if (!pixels_) {
+            SDL_Log("GlyphAtlas surface: %s", SDL_GetError());
+            return false;
+        }
+        SDL_FillRect(pixels_, NULL, SDL_MapRGBA(pixels_->format, 255, 255, 255, 0));
+
+        lineHeight_ = TTF_FontHeight(font);
+        invalidate();
+        shaped_.clear();
+
+        int shelfX = 0;
+        int shelfY = 0;
+        int shelfHeight = 0;
+
+        for (char ch = GLYPH_ATLAS_FIRST_CHAR; ch <= GLYPH_ATLAS_LAST_CHAR; ch++) {
+            Glyph &cur = glyphs_[ch - GLYPH_ATLAS_FIRST_CHAR];
+            cur = {};
+
+            int minX = 0, maxX = 0, minY = 0, maxY = 0;
+            if (TTF_GlyphMetrics(font, (Uint16) ch, &minX, &maxX, &minY, &maxY, &cur.advance) != 0) continue;
+
+            SDL_Surface *glyphSurface = TTF_RenderGlyph_Blended(font, (Uint16) ch, WHITE_SDL_COLOR);
+            if (!glyphSurface) continue;
+
+            if (shelfX + glyphSurface->w > GLYPH_ATLAS_SIZE) {
+                shelfX = 0;
+                shelfY += shelfHeight + GLYPH_ATLAS_PADDING;
+                shelfHeight = 0;
+            }
+            if (shelfY + glyphSurface->h > GLYPH_ATLAS_SIZE) {
+                SDL_Log("GlyphAtlas: font is too large for a %dx%d atlas", GLYPH_ATLAS_SIZE, GLYPH_ATLAS_SIZE);
+                SDL_FreeSurface(glyphSurface);
+                break;
+            }
+
+            cur.src = {shelfX, shelfY, glyphSurface->w, glyphSurface->h};
+            SDL_SetSurfaceBlendMode(glyphSurface, SDL_BLENDMODE_NONE);
+            SDL_BlitSurface(glyphSurface, NULL, pixels_, &cur.src);
+
+            shelfX += glyphSurface->w + GLYPH_ATLAS_PADDING;
+            shelfHeight = std::max(shelfHeight, glyphSurface->h);
+            SDL_FreeSurface(glyphSurface);
+        }
+
+        return true;
+    }
+
+    // Must be called while the renderer the texture was uploaded to is alive.
+    void invalidate() {
+        if (texture_) SDL_DestroyTexture(texture_);
+        texture_ = nullptr;
+        renderer_ = nullptr;
+    }
+
+    void releaseTextures() override { invalidate(); }
+
+    int lineHeight() const { return lineHeight_; }
+
+    const ShapedText &shape(const std::string &text) {
+        auto it = shaped_.find(text);
+        if (it != shaped_.end()) return it->second;
+
+        // Live readouts produce a new string almost every tick; start over
+        // rather than tracking recency.
+        if (shaped_.size() >= GLYPH_ATLAS_SHAPED_CACHE_SIZE) shaped_.clear();
+
+        ShapedText &shaped = shaped_[text];
+        shaped.vertices.reserve(text.size() * 4);
+        shaped.height = lineHeight_;
+
+        for (char ch : text) {
+            const Glyph &cur = glyph(ch);
+
+            if (cur.src.w > 0 && cur.src.h > 0) {
+                float x1 = (float) shaped.width,               y1 = 0;
+                float x2 = (float) (shaped.width + cur.src.w), y2 = (float) cur.src.h;
+
+                float u1 = (float) cur.src.x / GLYPH_ATLAS_SIZE,               v1 = (float) cur.src.y / GLYPH_ATLAS_SIZE;
+                float u2 = (float) (cur.src.x + cur.src.w) / GLYPH_ATLAS_SIZE, v2 = (float) (cur.src.y + cur.src.h) / GLYPH_ATLAS_SIZE;
+
+                shaped.vertices.push_back({{x1, y1}, WHITE_SDL_COLOR, {u1, v1}});
+                shaped.vertices.push_back({{x2, y1}, WHITE_SDL_COLOR, {u2, v1}});
+                shaped.vertices.push_back({{x2, y2}, WHITE_SDL_COLOR, {u2, v2}});
+                shaped.vertices.push_back({{x1, y2}, WHITE_SDL_COLOR, {u1, v2}});
+            }
+
+            shaped.width += cur.advance;
+        }
+
+        return shaped;
+    }
+
+    void queue(const std::string &text, int x, int y, const SDL_Color &color) {
+        const ShapedText &shaped = shape(text);
+        const int quadIndices[] = {0, 1, 2, 0, 2, 3};
+
+        for (size_t quad = 0; quad < shaped.vertices.size(); quad += 4) {
+            int base = (int) batchVertices_.size();
+
+            for (size_t i = 0; i < 4; i++) {
+                SDL_Vertex vertex = shaped.vertices[quad + i];
+                vertex.position.x += x;
+                vertex.position.y += y;
+                vertex.color = color;
+                batchVertices_.push_back(vertex);
+            }
+            for (int idx : quadIndices) batchIndices_.push_back(base + idx);
+        }
+    }
+
+    void flush(SDL_Renderer *renderer) {
+        if (!batchIndices_.empty() && bind(renderer)) {
+            SDL_RenderGeometry(renderer, texture_, batchVertices_.data(), (int) batchVertices_.size(), batchIndices_.data(), (int) batchIndices_.size());
+        }
+
+        batchVertices_.clear();
+        batchIndices_.clear();
+    }
+
+    void draw(SDL_Renderer *renderer, const std::string &text, int x, int y, const SDL_Color &color) {
+        queue(text, x, y, color);
+        flush(renderer);
+    }
+};
+
+#endif // GLYPH_ATLAS_H
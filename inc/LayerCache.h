@@ -0,0 +1,90 @@
+#ifndef LAYER_CACHE_H
+#define LAYER_CACHE_H
+
+#include "MyGUI.h"
+#include "RenderResources.h"
+
+// Texture holding the part of a widget that rarely changes. It is redrawn
+// only after invalidate(), a resize, a renderer switch or a render reset;
+// otherwise draw() is a single SDL_RenderCopy.
+class StaticLayer : public RenderResource {
+    SDL_Renderer *renderer_ = nullptr;
+    SDL_Texture *texture_ = nullptr;
+    int width_ = 0;
+    int height_ = 0;
+    bool valid_ = false;
+
+public:
+    StaticLayer() = default;
+
+    ~StaticLayer() override { releaseTextures(); }
+
+    void invalidate() { valid_ = false; }
+
+    void releaseTextures() override {
+        if (texture_) SDL_DestroyTexture(texture_);
+        texture_ = nullptr;
+        renderer_ = nullptr;
+        valid_ = false;
+    }
+
+    template <typename DrawFunc>
+    void draw(SDL_Renderer* renderer, int width, int height, DrawFunc drawStatic) {
+        assert(renderer);
+
+        if (renderer != renderer_ || width != width_ || height != height_) {
+            releaseTextures();
+
+            texture_ = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, width, height);
+            if (!texture_) SDL_Log("StaticLayer texture: %s", SDL_GetError());
+            else           SDL_SetTextureBlendMode(texture_, SDL_BLENDMODE_BLEND);
+
+            renderer_ = renderer;
+            width_ = width;
+            height_ = height;
+            valid_ = false;
+        }
+
+        if (!texture_) {
+            drawStatic(renderer);
+            return;
+        }
+
+        if (!valid_) {
+            SDL_Texture* prevTarget = SDL_GetRenderTarget(renderer);
+            SDL_SetRenderTarget(renderer, texture_);
+
+            SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+            SDL_RenderClear(renderer);
+            drawStatic(renderer);
+
+            SDL_SetRenderTarget(renderer, prevTarget);
+            valid_ = true;
+        }
+
+        SDL_Rect dst = {0, 0, width_, height_};
+        SDL_RenderCopy(renderer, texture_, NULL, &dst);
+    }
+};
+
+// Remembers what the dynamic part of a widget looked like when it was last
+// drawn, expressed as a small comparable key (pixel coordinates, a colour).
+// update() reports whether the new key would produce different pixels.
+template <typename Key>
+class DynamicOverlay {
+    Key drawnKey_ = {};
+    bool drawn_ = false;
+
+public:
+    bool update(const Key &key) {
+        if (drawn_ && key == drawnKey_) return false;
+
+        drawnKey_ = key;
+        drawn_ = true;
+        return true;
+    }
+
+    void invalidate() { drawn_ = false; }
+};
+
+#endif // LAYER_CACHE_H
@@ -1,12 +1,18 @@
 #ifndef PLOTS_H
 #define PLOTS_H
 
+#include <cmath>
+#include <span>
+#include <string>
 #include <vector>
-#include <deque>
 #include <limits>
 
 #include "MyGUI.h"
 #include "ScrollBar.h"
+#include "RingBuffer.h"
+#include "RecorderHistory.h"
+#include "RenderResources.h"
+#include "Profiler.h"
 
 
 const int RECORDER_BORDER_SIZE = 10;
@@ -14,6 +20,11 @@ const int RECORDER_LINE_THICKNESS = 1;
 const int RECORDER_AXEMARK_THICKNESS = 2;
 const int RECORDER_DOT_SIZE = 1;
 
+enum class RecorderDrawMode {
+    DOTS,
+    LINES
+};
+
 struct CordPoint {
     double x, y;
     int type;   
@@ -29,61 +40,176 @@ public:
     const std::vector<CordPoint> points() const { return points_; }
 };
 
-struct RecordPoint {
-    double y;
-    bool state;
-    unsigned int type;
+const size_t RECORDER_PYRAMID_LEVELS = 18;
+
+struct MinMax {
+    double min, max;
+
+    void merge(double value) {
+        min = std::min(min, value);
+        max = std::max(max, value);
+    }
+};
+
+// Sample history with an incrementally maintained min/max pyramid: level k
+// holds one MinMax per aligned block of 2^k samples, so any zoom level can
+// be drawn from roughly two values per pixel column. Every level keeps the
+// newest `capacity` entries, i.e. it covers capacity * 2^k samples.
+class DecimatedSeries {
+    RingBuffer<double> samples_;
+    std::vector<RingBuffer<MinMax>> levels_ = {};
+    std::vector<MinMax> pending_ = {};
+    unsigned long long count_ = 0;
+
+public:
+    explicit DecimatedSeries(size_t capacity): samples_(capacity) {
+        for (size_t level = 1; level <= RECORDER_PYRAMID_LEVELS; level++) levels_.emplace_back(capacity);
+        pending_.resize(levels_.size() + 1);
+    }
+
+    void append(double value) {
+        samples_.push_back(value);
+
+        for (size_t level = 1; level <= levels_.size(); level++) {
+            unsigned long long blockSize = 1ull << level;
+            MinMax &pending = pending_[level];
+
+            if (count_ % blockSize == 0) pending = {value, value};
+            else                        pending.merge(value);
+
+            if ((count_ + 1) % blockSize == 0) levels_[level - 1].push_back(pending);
+        }
+        count_++;
+    }
+
+    // Absolute indices: [firstIdx(), count()) are still retained.
+    unsigned long long count() const { return count_; }
+    unsigned long long firstIdx() const { return count_ - samples_.size(); }
+    size_t levelsCount() const { return levels_.size(); }
+
+    double sample(unsigned long long idx) const { return samples_[idx - firstIdx()]; }
+
+    // Min/max over block `block` of size 2^level, including the unfinished last block.
+    bool block(size_t level, unsigned long long block, MinMax &result) const {
+        assert(level >= 1 && level <= levels_.size());
+
+        const RingBuffer<MinMax> &blocks = levels_[level - 1];
+        unsigned long long completed = count_ >> level;
+
+        if (block == completed) {
+            if (count_ % (1ull << level) == 0) return false;
+            result = pending_[level];
+            return true;
+        }
+        if (block > completed || block + blocks.size() < completed) return false;
+
+        result = blocks[blocks.size() - (completed - block)];
+        return true;
+    }
+};
+
+struct RecorderChannel {
+    std::string name;
+    unsigned int color;
+    DecimatedSeries samples;
 };
 
+// Channels are registered once and then filled together, one value per
+// channel per record, each channel in its own column.
 class RecorderModel {
     bool reScalingMode_ = false;
-    int pixelWidth_ = 0;
     int pixelHeight_ = 0;
 
-    bool curPointState = true;
     double fixedYScale = 1;
 
-    std::deque<RecordPoint> points_;
+    // A widget w pixels wide draws at most 2w + 1 samples, or blocks of the
+    // pyramid level picked for its zoom, so that is all that is kept in memory.
+    size_t seriesCapacity_ = 0;
+    std::vector<RecorderChannel> channels_ = {};
+    unsigned long long recordsCount_ = 0;
+    RecorderHistoryFile history_;
 
     bool needsRecalc_ = true;
 
 private:
     void setRecalculatePointsFlag() { needsRecalc_ = true; }
 
+    void fitYScale(double y) {
+        if (reScalingMode_ && recordsCount_ == 0 && std::abs(y) > std::numeric_limits<double>::epsilon())
+            fixedYScale = pixelHeight_ / y;
+
+        double pixelY = y * fixedYScale;
+        if (pixelY > pixelHeight_) fixedYScale = pixelHeight_ / y;
+    }
+
 public:
     RecorderModel(double pixelWidth, double pixelHeight, double startScale) : 
-        pixelWidth_(pixelWidth), pixelHeight_(pixelHeight), fixedYScale(startScale) {}
+        pixelHeight_(pixelHeight), fixedYScale(startScale),
+        seriesCapacity_(2 * (size_t) std::max(pixelWidth, 0.0) + 2) {}
 
-    void addPoint(double y, unsigned int type) { 
-        if (reScalingMode_ && points_.size() == 0 && std::abs(y) > std::numeric_limits<double>::epsilon())
-            fixedYScale = pixelHeight_ / y;
-    
-        if (points_.size() > pixelWidth_) {
-            bool fstPointState = points_.front().state;
-            while (points_.size()) {
-                bool curPointState = points_.front().state;
-                if (curPointState != fstPointState) break;
-                points_.pop_front();
-            }
+    // Channels must be registered before the first record.
+    int addChannel(const std::string &name, unsigned int color) {
+        assert(recordsCount_ == 0);
+
+        channels_.push_back({name, color, DecimatedSeries(seriesCapacity_)});
+        return (int) channels_.size() - 1;
+    }
+
+    void recordValues(double timestamp, std::span<const double> values) {
+        PROFILE_SCOPE("RecorderModel::recordValues");
+        assert(values.size() == channels_.size());
+
+        for (size_t i = 0; i < channels_.size(); i++) {
+            fitYScale(values[i]);
+            channels_[i].samples.append(values[i]);
         }
-        
-        points_.push_back({y, curPointState, type});
+        recordsCount_++;
+        history_.append(timestamp, values);
+    }
 
-        double pixelY = y * fixedYScale;
-        if (pixelY > pixelHeight_) fixedYScale = pixelHeight_ / y;
+    // Every following record is also appended to an on-disk history at `path`,
+    // so nothing is lost when it scrolls out of the in-memory window.
+    bool spillToFile(const char *path) {
+        std::vector<std::string> names;
+        for (const RecorderChannel &channel : channels_) names.push_back(channel.name);
+
+        return history_.open(path, names);
     }
 
-    void endRecord() { curPointState = !curPointState; }
+    template <typename... Values>
+    void record(double timestamp, Values... values) {
+        const double packed[] = {(double) values...};
+        recordValues(timestamp, packed);
+    }
 
     double yScale() const { return fixedYScale; }
-    std::deque<RecordPoint> points() const { return points_; }
+    unsigned long long recordsCount() const { return recordsCount_; }
+    const std::vector<RecorderChannel> &channels() const { return channels_; }
 };
 
-class RecorderWidget : public Widget {
+class RecorderWidget : public Widget, public RenderResource {
     RecorderModel recorder_;
     double xScale_ = 1;
     double yScale_ = 1;
     bool reScalingMode_ = false;
+    RecorderDrawMode drawMode_ = RecorderDrawMode::DOTS;
+
+    // Reused between draws so that a channel is submitted in one call without allocating.
+    std::vector<SDL_Point> linePoints_ = {};
+    std::vector<SDL_Rect> fillRects_ = {};
+
+    // The plot is kept in a render target and scrolled instead of redrawn:
+    // two textures are ping-ponged because SDL can't copy a texture onto itself.
+    SDL_Renderer *plotRenderer_ = nullptr;
+    SDL_Texture *plotTextures_[2] = {};
+    int plotTexturesWidth_ = 0;
+    int plotTexturesHeight_ = 0;
+    int curPlotTexture_ = 0;
+
+    bool needFullRedraw_ = true;
+    double drawnYScale_ = 0;
+    unsigned long long drawnFrom_ = 0;
+    unsigned long long drawnTo_ = 0;
 
 private:
     void drawVerticalAxe(SDL_Renderer* renderer, double yScale) {
@@ -94,47 +220,207 @@ private:
         SDL_RenderFillRect(renderer, &rect);
     }
 
+    size_t pyramidLevel(double xScale) const {
+        size_t level = 0;
+        while (level < RECORDER_PYRAMID_LEVELS && (1ull << (level + 1)) * xScale <= 1) level++;
+        return level;
+    }
+
+    // Newest records that fit into the widget, [from, to) in absolute indices;
+    // the newest one lands in the last pixel column, x = w - 1.
+    void visibleRange(double xScale, unsigned long long &from, unsigned long long &to) const {
+        unsigned long long visibleCount = (unsigned long long) (std::max(rect_.w - 1, 0) / xScale) + 1;
+
+        to = recorder_.recordsCount();
+        from = (to > visibleCount ? to - visibleCount : 0);
+    }
+
+    // Draws samples [drawFrom, to) of a channel placed so that `from` is at x = 0,
+    // submitting the whole channel with a single SDL call. When several samples
+    // share a pixel column, each pyramid block is drawn as a min-max bar.
+    void drawChannel(SDL_Renderer* renderer, const RecorderChannel &channel, unsigned long long from,
+                    unsigned long long drawFrom, unsigned long long to, double xScale, double yScale) {
+        const DecimatedSeries &samples = channel.samples;
+        SDL_Color color = Uint32ToSDL2gfxColor(channel.color);
+
+        unsigned long long firstIdx = std::max(from, samples.firstIdx());
+        drawFrom = std::max(drawFrom, firstIdx);
+        to = std::min(to, samples.count());
+        if (drawFrom >= to) return;
+
+        SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
+
+        size_t level = pyramidLevel(xScale);
+
+        if (level == 0 && drawMode_ == RecorderDrawMode::LINES) {
+            // Start from the last drawn sample so that an appended segment stays connected.
+            if (drawFrom > firstIdx) drawFrom--;
+
+            linePoints_.clear();
+            for (unsigned long long idx = drawFrom; idx < to; idx++) {
+                int x = (int) ((idx - from) * xScale);
+                int y = (int) (-(samples.sample(idx) * yScale) + rect_.h);
+                linePoints_.push_back({x, y});
+            }
+
+            if (linePoints_.size() == 1) SDL_RenderDrawPoints(renderer, linePoints_.data(), 1);
+            else                         SDL_RenderDrawLines(renderer, linePoints_.data(), (int) linePoints_.size());
+            return;
+        }
+
+        fillRects_.clear();
+
+        if (level == 0) {
+            for (unsigned long long idx = drawFrom; idx < to; idx++) {
+                int x = (int) ((idx - from) * xScale);
+                int y = (int) (-(samples.sample(idx) * yScale) + rect_.h);
+                fillRects_.push_back({x - RECORDER_DOT_SIZE, y - RECORDER_DOT_SIZE, 2 * RECORDER_DOT_SIZE + 1, 2 * RECORDER_DOT_SIZE + 1});
+            }
+        } else {
+            for (unsigned long long block = drawFrom >> level; block <= (to - 1) >> level; block++) {
+                MinMax minMax = {};
+                if (!samples.block(level, block, minMax)) continue;
+
+                int x = (int) (std::max(0.0, ((double) (block << level) - (double) from) * xScale));
+                int yMin = (int) (-(minMax.min * yScale) + rect_.h);
+                int yMax = (int) (-(minMax.max * yScale) + rect_.h);
+                fillRects_.push_back({x, yMax, 1, yMin - yMax + 1});
+            }
+        }
+
+        SDL_RenderFillRects(renderer, fillRects_.data(), (int) fillRects_.size());
+    }
+
+    void destroyPlotTextures() {
+        for (SDL_Texture *&texture : plotTextures_) {
+            if (texture) SDL_DestroyTexture(texture);
+            texture = nullptr;
+        }
+    }
+
+    void initPlotTextures(SDL_Renderer* renderer) {
+        destroyPlotTextures();
+
+        for (SDL_Texture *&texture : plotTextures_) {
+            texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, rect_.w, rect_.h);
+            if (!texture) SDL_Log("RecorderWidget plot texture: %s", SDL_GetError());
+            else          SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_NONE);
+        }
+        plotRenderer_ = renderer;
+        plotTexturesWidth_ = rect_.w;
+        plotTexturesHeight_ = rect_.h;
+        curPlotTexture_ = 0;
+        needFullRedraw_ = true;
+    }
+
+    void redrawPlot(SDL_Renderer* renderer, unsigned long long from, unsigned long long to, double xScale, double yScale) {
+        SDL_SetRenderTarget(renderer, plotTextures_[curPlotTexture_]);
+
+        SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+        SDL_RenderClear(renderer);
+
+        for (const RecorderChannel &channel : recorder_.channels()) {
+            drawChannel(renderer, channel, from, from, to, xScale, yScale);
+        }
+    }
+
+    void scrollPlot(SDL_Renderer* renderer, int shift, unsigned long long from, unsigned long long to, double xScale, double yScale) {
+        if (shift > 0) {
+            int nextPlotTexture = 1 - curPlotTexture_;
+            SDL_SetRenderTarget(renderer, plotTextures_[nextPlotTexture]);
+
+            SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+            SDL_RenderClear(renderer);
+
+            SDL_Rect src = {shift, 0, rect_.w - shift, rect_.h};
+            SDL_Rect dst = {0, 0, rect_.w - shift, rect_.h};
+            SDL_RenderCopy(renderer, plotTextures_[curPlotTexture_], &src, &dst);
+            curPlotTexture_ = nextPlotTexture;
+        } else {
+            SDL_SetRenderTarget(renderer, plotTextures_[curPlotTexture_]);
+        }
+
+        for (const RecorderChannel &channel : recorder_.channels()) {
+            drawChannel(renderer, channel, from, drawnTo_, to, xScale, yScale);
+        }
+    }
+
 public:
     RecorderWidget(int width, int height, double startScale=1, bool reScalingMode=false, Widget *parent=nullptr): 
         Widget(width, height, parent), recorder_(width, height, startScale), reScalingMode_(reScalingMode) {}
 
+    ~RecorderWidget() override { destroyPlotTextures(); }
+
+    // After a render reset the next render recreates the textures and redraws the plot.
+    void releaseTextures() override {
+        destroyPlotTextures();
+        plotRenderer_ = nullptr;
+        setRerenderFlag();
+    }
+
     void renderSelfAction(SDL_Renderer* renderer) override {
+        PROFILE_SCOPE("RecorderWidget::renderSelfAction");
         assert(renderer);
-    
-        SDL_Rect widgetRect = {0, 0, rect_.w, rect_.h};
-        SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-        SDL_RenderFillRect(renderer, &widgetRect);
 
-        drawVerticalAxe(renderer, recorder_.yScale());
+        if (renderer != plotRenderer_ || rect_.w != plotTexturesWidth_ || rect_.h != plotTexturesHeight_) {
+            initPlotTextures(renderer);
+        }
+        if (!plotTextures_[0] || !plotTextures_[1]) return;
 
-        for (int i = 0; i < recorder_.points().size(); i++) {
-            RecordPoint point = recorder_.points()[i];
-            SDL_Color pointColor = Uint32ToSDL2gfxColor(point.type);
-            
-            double xScale = xScale_;
-            double yScale = (reScalingMode_ ? recorder_.yScale() : yScale_);
-            
+        double xScale = xScale_;
+        double yScale = (reScalingMode_ ? recorder_.yScale() : yScale_);
 
-            double x = i * xScale;
-            double y = -(point.y * yScale) + rect_.h;
+        unsigned long long from = 0, to = 0;
+        visibleRange(xScale, from, to);
 
-            SDL_SetRenderDrawColor(renderer, pointColor.r, pointColor.g, pointColor.b, pointColor.a);
-            filledCircleColor(renderer, x, y, RECORDER_DOT_SIZE, point.type);
-        }
+        // Only whole-pixel scrolls of raw samples can reuse what is already drawn.
+        double shift = (from >= drawnFrom_ ? (from - drawnFrom_) * xScale : -1);
+        bool canScroll = !needFullRedraw_ && yScale == drawnYScale_ && pyramidLevel(xScale) == 0 &&
+                         to >= drawnTo_ && shift >= 0 && shift < rect_.w && shift == std::floor(shift);
+
+        SDL_Texture* prevTarget = SDL_GetRenderTarget(renderer);
+        if (canScroll) scrollPlot(renderer, (int) shift, from, to, xScale, yScale);
+        else           redrawPlot(renderer, from, to, xScale, yScale);
+        SDL_SetRenderTarget(renderer, prevTarget);
+
+        needFullRedraw_ = false;
+        drawnYScale_ = yScale;
+        drawnFrom_ = from;
+        drawnTo_ = to;
+
+        SDL_Rect dst = {0, 0, rect_.w, rect_.h};
+        SDL_RenderCopy(renderer, plotTextures_[curPlotTexture_], NULL, &dst);
+
+        drawVerticalAxe(renderer, recorder_.yScale());
     }
 
     void setXScale(double scale) { 
         xScale_ = scale; 
+        needFullRedraw_ = true;
         setRerenderFlag(); 
     }
 
     void setYScale(double scale) { 
         yScale_ = scale; 
+        needFullRedraw_ = true;
         setRerenderFlag(); 
     }
 
-    void addPoint(double y, SDL_Color color) { recorder_.addPoint(y, SDL2gfxColorToUint32(color)); }
-    void endRecord() { recorder_.endRecord(); }
+    bool spillToFile(const char *path) { return recorder_.spillToFile(path); }
+
+    void setDrawMode(RecorderDrawMode drawMode) {
+        drawMode_ = drawMode;
+        needFullRedraw_ = true;
+        setRerenderFlag();
+    }
+
+    int addChannel(const std::string &name, SDL_Color color) { return recorder_.addChannel(name, SDL2gfxColorToUint32(color)); }
+
+    template <typename... Values>
+    void record(double timestamp, Values... values) { 
+        recorder_.record(timestamp, values...); 
+        setRerenderFlag();
+    }
 };
 
 class RecorderWindow : public Window {
@@ -146,17 +432,18 @@ public:
         addWidget(WINDOW_BORDER_SIZE, WINDOW_BORDER_SIZE, recorder_);
     }
 
-    void addPoint(double y, SDL_Color color) { 
-        recorder_->addPoint(y, color); 
-        recorder_->setRerenderFlag();
-    }
+    int addChannel(const std::string &name, SDL_Color color) { return recorder_->addChannel(name, color); }
+    void setDrawMode(RecorderDrawMode drawMode) { recorder_->setDrawMode(drawMode); }
+    bool spillToFile(const char *path) { return recorder_->spillToFile(path); }
 
-    void endRecord() { recorder_->endRecord(); }
+    template <typename... Values>
+    void record(double timestamp, Values... values) { recorder_->record(timestamp, values...); }
 };
 
 class ScrollRecorderWindow : public Window {
     static constexpr const double SCROLL_BAR_LAYOUT_SHARE = 0.2;
     static constexpr const double X_ZOOM_COEF = 5;
+    static constexpr const double MAX_X_ZOOM_OUT = 2048;
     static constexpr const double Y_ZOOM_COEF = 20;
     int scrollBarLen_ = 0;
 
@@ -175,7 +462,7 @@ public:
         scrollBarLen_ = width * SCROLL_BAR_LAYOUT_SHARE - 2 * RECORDER_BORDER_SIZE;
     
         xScaleScrollBar_ = new ScrollBar(width - scrollBarLen_ - 2 * RECORDER_BORDER_SIZE, scrollBarLen_, 
-            [this](double percent) { recorder_->setXScale(startScaleX_ * (1 + percent)); }, true, this);
+            [this](double percent) { recorder_->setXScale(startScaleX_ / std::pow(MAX_X_ZOOM_OUT, percent)); }, true, this);
         
         yScaleScrollBar_ = new ScrollBar(scrollBarLen_, height - scrollBarLen_ - 2 * RECORDER_BORDER_SIZE, 
             [this](double percent) { recorder_->setYScale(startScaleY_ * percent); }, false, this);
@@ -187,12 +474,12 @@ public:
         addWidget(RECORDER_BORDER_SIZE + scrollBarLen_, RECORDER_BORDER_SIZE + scrollBarLen_, recorder_);
     }
 
-    void addPoint(double y, SDL_Color color) { 
-        recorder_->addPoint(y, color); 
-        recorder_->setRerenderFlag();
-    }
+    int addChannel(const std::string &name, SDL_Color color) { return recorder_->addChannel(name, color); }
+    void setDrawMode(RecorderDrawMode drawMode) { recorder_->setDrawMode(drawMode); }
+    bool spillToFile(const char *path) { return recorder_->spillToFile(path); }
 
-    void endRecord() { recorder_->endRecord(); }
+    template <typename... Values>
+    void record(double timestamp, Values... values) { recorder_->record(timestamp, values...); }
 };
 
 
@@ -0,0 +1,214 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+// Scoped timing instrumentation. Everything below is compiled only with
+// REACTOR_PROFILE defined (cmake -DREACTOR_PROFILE=ON); otherwise the macros
+// expand to nothing and no profiler code or data exists in the binary.
+//
+//   PROFILE_THREAD_NAME("simulation");    // once per thread, names the trace row
+//   PROFILE_SCOPE("ReactorModel::update"); // times the enclosing scope
+//   PROFILE_FRAME();                       // once per frame, times frame to frame
+//
+// Names must be string literals or otherwise outlive the profiler.
+
+#ifdef REACTOR_PROFILE
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+const size_t PROFILER_THREAD_EVENTS_CAPACITY = 1 << 16;
+
+// Event names of the frame breakdown shown by ProfilerOverlay.
+const char PROFILE_FRAME_NAME[] = "frame";
+const char PROFILE_FRAME_UPDATE_NAME[] = "frame update";
+
+struct ProfileEvent {
+    const char *name;
+    int64_t startNS;
+    int64_t durationNS;
+};
+
+// Events of one thread. Only the owning thread writes; readers copy the
+// newest events and drop any that the writer may have overwritten meanwhile.
+// The sequence is a seqlock counter, odd while a slot is being written and
+// twice the number of written events otherwise. Slot fields are relaxed
+// atomics, which compile to plain moves.
+class ProfileThreadBuffer {
+    struct Slot {
+        std::atomic<const char *> name = nullptr;
+        std::atomic<int64_t> startNS = 0;
+        std::atomic<int64_t> durationNS = 0;
+    };
+
+    std::vector<Slot> events_;
+    std::atomic<uint64_t> sequence_ = 0;
+    int threadId_;
+    std::atomic<const char *> threadName_ = nullptr;
+
+public:
+    explicit ProfileThreadBuffer(int threadId): events_(PROFILER_THREAD_EVENTS_CAPACITY), threadId_(threadId) {}
+
+    void push(const ProfileEvent &event) {
+        uint64_t sequence = sequence_.load(std::memory_order_relaxed);
+        sequence_.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        Slot &slot = events_[(sequence / 2) % events_.size()];
+        slot.name.store(event.name, std::memory_order_relaxed);
+        slot.startNS.store(event.startNS, std::memory_order_relaxed);
+        slot.durationNS.store(event.durationNS, std::memory_order_relaxed);
+
+        sequence_.store(sequence + 2, std::memory_order_release);
+    }
+
+    template <typename Func>
+    void forEachEvent(Func func) const {
+        uint64_t end = sequence_.load(std::memory_order_acquire) / 2;
+        uint64_t begin = (end > events_.size() ? end - events_.size() : 0);
+
+        std::vector<ProfileEvent> copy;
+        copy.reserve(end - begin);
+        for (uint64_t i = begin; i < end; i++) {
+            const Slot &slot = events_[i % events_.size()];
+            copy.push_back({slot.name.load(std::memory_order_relaxed),
+                            slot.startNS.load(std::memory_order_relaxed),
+                            slot.durationNS.load(std::memory_order_relaxed)});
+        }
+
+        // Any slot the copy saw half-written shows up here as a started
+        // write; the events those writes replace are dropped.
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t started = (sequence_.load(std::memory_order_relaxed) + 1) / 2;
+        uint64_t validBegin = (started > events_.size() ? started - events_.size() : 0);
+
+        for (uint64_t i = std::max(begin, validBegin); i < end; i++) func(copy[i - begin]);
+    }
+
+    int threadId() const { return threadId_; }
+    const char *threadName() const { return threadName_.load(std::memory_order_acquire); }
+    void setThreadName(const char *name) { threadName_.store(name, std::memory_order_release); }
+};
+
+class Profiler {
+    std::mutex threadsMutex_;
+    std::vector<std::shared_ptr<ProfileThreadBuffer>> threads_ = {};
+    std::chrono::steady_clock::time_point origin_ = std::chrono::steady_clock::now();
+    std::atomic<bool> dumpRequested_ = false;
+
+public:
+    static Profiler &instance() {
+        static Profiler profiler;
+        return profiler;
+    }
+
+    // Buffers outlive their threads, so events of finished threads still
+    // appear in the trace.
+    ProfileThreadBuffer &threadBuffer() {
+        thread_local std::shared_ptr<ProfileThreadBuffer> buffer = [this] {
+            std::lock_guard<std::mutex> lock(threadsMutex_);
+            threads_.push_back(std::make_shared<ProfileThreadBuffer>((int) threads_.size() + 1));
+            return threads_.back();
+        }();
+        return *buffer;
+    }
+
+    // Records the time since the previous call on this thread as one frame.
+    void markFrame() {
+        thread_local int64_t frameStartNS = -1;
+        int64_t now = nowNS();
+
+        if (frameStartNS >= 0) threadBuffer().push({PROFILE_FRAME_NAME, frameStartNS, now - frameStartNS});
+        frameStartNS = now;
+    }
+
+    int64_t nowNS() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin_).count();
+    }
+
+    template <typename Func>
+    void forEachThread(Func func) {
+        std::vector<std::shared_ptr<ProfileThreadBuffer>> threads;
+        {
+            std::lock_guard<std::mutex> lock(threadsMutex_);
+            threads = threads_;
+        }
+        for (const std::shared_ptr<ProfileThreadBuffer> &thread : threads) func(*thread);
+    }
+
+    // Async-signal-safe, for use from a signal handler.
+    void requestDump() { dumpRequested_.store(true, std::memory_order_relaxed); }
+
+    void dumpIfRequested(const char *path) {
+        if (dumpRequested_.exchange(false, std::memory_order_relaxed)) dumpChromeTrace(path);
+    }
+
+    // Writes the buffered events in the Chrome trace-event format, loadable
+    // in chrome://tracing or Perfetto.
+    bool dumpChromeTrace(const char *path) {
+        FILE *file = fopen(path, "w");
+        if (!file) {
+            perror(path);
+            return false;
+        }
+
+        fprintf(file, "{\"traceEvents\":[\n");
+        bool first = true;
+
+        forEachThread([file, &first](const ProfileThreadBuffer &thread) {
+            if (thread.threadName()) {
+                fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                        (first ? "" : ",\n"), thread.threadId(), thread.threadName());
+                first = false;
+            }
+
+            thread.forEachEvent([file, &first, &thread](const ProfileEvent &event) {
+                fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                        (first ? "" : ",\n"), event.name, thread.threadId(), event.startNS / 1000.0, event.durationNS / 1000.0);
+                first = false;
+            });
+        });
+
+        fprintf(file, "\n]}\n");
+        fclose(file);
+        return true;
+    }
+};
+
+class ProfileScope {
+    const char *name_;
+    int64_t startNS_;
+
+public:
+    explicit ProfileScope(const char *name): name_(name), startNS_(Profiler::instance().nowNS()) {}
+
+    ~ProfileScope() {
+        Profiler &profiler = Profiler::instance();
+        profiler.threadBuffer().push({name_, startNS_, profiler.nowNS() - startNS_});
+    }
+
+    ProfileScope(const ProfileScope &) = delete;
+    ProfileScope &operator=(const ProfileScope &) = delete;
+};
+
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope_, __LINE__)(name)
+#define PROFILE_THREAD_NAME(name) Profiler::instance().threadBuffer().setThreadName(name)
+#define PROFILE_FRAME() Profiler::instance().markFrame()
+
+#else
+
+#define PROFILE_SCOPE(name)
+#define PROFILE_THREAD_NAME(name)
+#define PROFILE_FRAME()
+
+#endif // REACTOR_PROFILE
+
+#endif // PROFILER_H
@@ -0,0 +1,126 @@
+#ifndef PROFILER_OVERLAY_H
+#define PROFILER_OVERLAY_H
+
+#ifdef REACTOR_PROFILE
+
+#include <cstdio>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "MyGUI.h"
+#include "GlyphAtlas.h"
+#include "Profiler.h"
+
+
+// Timings over the last second: calls, average and worst duration. The
+// first lines break the UI frame down into the update tick and the rest of
+// the frame (widget updates, rendering, presentation and waiting for the
+// next frame); one line per PROFILE_SCOPE name across all threads follows.
+class ProfilerOverlay : public Window {
+    static constexpr const int FONT_SIZE = 10;
+    static constexpr const int TEXT_PADDING = 4;
+    static constexpr const int REFRESH_PERIOD_MS = 500;
+    static constexpr const int64_t STATS_WINDOW_NS = 1000000000;
+    static constexpr const int LINE_BUFFER_SIZE = 128;
+
+    static constexpr const SDL_Color TEXT_COLOR = {0, 255, 0, 255};
+
+    struct ScopeStats {
+        int calls = 0;
+        int64_t totalNS = 0;
+        int64_t maxNS = 0;
+    };
+
+    TTF_Font* font_ = nullptr;
+    GlyphAtlas atlas_;
+
+    std::vector<std::string> lines_ = {};
+    int sinceRefreshMS_ = 0;
+
+private:
+    void addFrameLines(const ScopeStats &frame, const ScopeStats &update) {
+        if (!frame.calls) return;
+
+        char line[LINE_BUFFER_SIZE] = "";
+        snprintf(line, sizeof(line), "%4d %7.3f %7.3f ms  %s", frame.calls, frame.totalNS / 1e6 / frame.calls, frame.maxNS / 1e6, PROFILE_FRAME_NAME);
+        lines_.push_back(line);
+
+        if (update.calls) {
+            snprintf(line, sizeof(line), "%4d %7.3f %7.3f ms    update", update.calls, update.totalNS / 1e6 / frame.calls, update.maxNS / 1e6);
+            lines_.push_back(line);
+        }
+        snprintf(line, sizeof(line), "%4d %7.3f       - ms    rest of frame", frame.calls, (frame.totalNS - update.totalNS) / 1e6 / frame.calls);
+        lines_.push_back(line);
+    }
+
+    void refresh() {
+        Profiler &profiler = Profiler::instance();
+        int64_t windowStartNS = profiler.nowNS() - STATS_WINDOW_NS;
+
+        std::map<std::string_view, ScopeStats> stats;
+        profiler.forEachThread([&stats, windowStartNS](const ProfileThreadBuffer &thread) {
+            thread.forEachEvent([&stats, windowStartNS](const ProfileEvent &event) {
+                if (event.startNS < windowStartNS) return;
+
+                ScopeStats &scope = stats[event.name];
+                scope.calls++;
+                scope.totalNS += event.durationNS;
+                scope.maxNS = std::max(scope.maxNS, event.durationNS);
+            });
+        });
+
+        lines_.clear();
+        addFrameLines(stats[PROFILE_FRAME_NAME], stats[PROFILE_FRAME_UPDATE_NAME]);
+        for (const auto &[name, scope] : stats) {
+            if (name == PROFILE_FRAME_NAME || name == PROFILE_FRAME_UPDATE_NAME) continue;
+
+            char line[LINE_BUFFER_SIZE] = "";
+            snprintf(line, sizeof(line), "%4d %7.3f %7.3f ms  %.*s",
+                     scope.calls, scope.totalNS / 1e6 / scope.calls, scope.maxNS / 1e6, (int) name.size(), name.data());
+            lines_.push_back(line);
+        }
+        setRerenderFlag();
+    }
+
+public:
+    ProfilerOverlay(int width, int height, const char fontPath[], Widget *parent=nullptr): Window(width, height, parent) {
+        font_ = TTF_OpenFont(fontPath, FONT_SIZE);
+        if (!font_) {
+            SDL_Log("TTF_OpenFont: %s", TTF_GetError());
+            assert(0);
+        }
+        atlas_.build(font_);
+    }
+
+    ~ProfilerOverlay() override { TTF_CloseFont(font_); }
+
+    void updateOverlay(int deltaMS) {
+        sinceRefreshMS_ += deltaMS;
+        if (sinceRefreshMS_ < REFRESH_PERIOD_MS) return;
+
+        sinceRefreshMS_ = 0;
+        refresh();
+    }
+
+    void renderSelfAction(SDL_Renderer* renderer) override {
+        assert(renderer);
+
+        SDL_SetRenderDrawColor(renderer, DEFAULT_WINDOW_COLOR.r, DEFAULT_WINDOW_COLOR.g, DEFAULT_WINDOW_COLOR.b, DEFAULT_WINDOW_COLOR.a);
+        SDL_Rect full = {0, 0, rect_.w, rect_.h};
+        SDL_RenderFillRect(renderer, &full);
+
+        int y = TEXT_PADDING;
+        atlas_.queue("calls     avg     max", TEXT_PADDING, y, TEXT_COLOR);
+        for (const std::string &line : lines_) {
+            y += atlas_.lineHeight();
+            atlas_.queue(line, TEXT_PADDING, y, TEXT_COLOR);
+        }
+        atlas_.flush(renderer);
+    }
+};
+
+#endif // REACTOR_PROFILE
+
+#endif // PROFILER_OVERLAY_H
@@ -1,8 +1,15 @@
 #ifndef REACTOR_GUI_H
 #define REACTOR_GUI_H
 
+#include <memory>
+
 #include "MyGUI.h"
 #include "ReactorModel.h"
+#include "ReactorSimulation.h"
+#include "Trajectory.h"
+#include "SpriteCache.h"
+#include "LayerCache.h"
+#include "Profiler.h"
 #include "SDL2/SDL2_gfxPrimitives.h"
 
 const SDL_Color CIRCLIT_COLOR = {255, 0, 0, 255};
@@ -12,6 +19,7 @@ const double REACTOR_WALL_TEMPERATURE_COLOR_COEF = 1.0 / 400000;
 const double NARROWING_DELTA = 10;
 const int SEC_TO_MS = 1000;
 const int EXPLODE_PARTICLES_NUM = 100;
+const int CIRCLE_BATCH_SEGMENTS = 16;
 
 struct ReactorButtonTexturePack {
     
@@ -29,45 +37,85 @@ struct ReactorButtonTexturePack {
     ButtonTexturePath explodeReactorBtnPath;
 };
 
-class MGShape {
-protected:
-    SDL_Point position_ = {};
-    SDL_Color color_ = {};
+// Accumulates filled shapes of one kind into a reusable vertex/index buffer
+// and submits them with a single SDL_RenderGeometry call.
+class MGShapeBatch {
+    std::vector<SDL_Vertex> vertices_ = {};
+    std::vector<int> indices_ = {};
+
+    SDL_FPoint circleTable_[CIRCLE_BATCH_SEGMENTS] = {};
 
 public:
-    MGShape(const SDL_Point &position, const SDL_Color &color): position_(position), color_(color) {};
-    virtual ~MGShape() = default;
+    MGShapeBatch() {
+        for (int i = 0; i < CIRCLE_BATCH_SEGMENTS; i++) {
+            double angle = 2 * M_PI * i / CIRCLE_BATCH_SEGMENTS;
+            circleTable_[i] = {(float) std::cos(angle), (float) std::sin(angle)};
+        }
+    }
 
-    virtual void draw(SDL_Renderer* renderer) const = 0;
-    SDL_Point position() const { return position_; }
-};
+    void clear() {
+        vertices_.clear();
+        indices_.clear();
+    }
 
-class MGCircle : public MGShape {
-    int radius_;
+    void reserve(size_t verticesCount, size_t indicesCount) {
+        vertices_.reserve(verticesCount);
+        indices_.reserve(indicesCount);
+    }
 
-public:
-    MGCircle(const SDL_Point &position, const int radius, const SDL_Color &color):
-        MGShape(position, color), radius_(radius) {};
+    void addCircle(const SDL_FPoint &center, float radius, const SDL_Color &color) {
+        int centerIdx = (int) vertices_.size();
 
-    void draw(SDL_Renderer* renderer) const override {
-        RendererGuard rendererGuard(renderer);
-        filledCircleColor(renderer, (Sint16) position_.x, (Sint16) position_.y, (Sint16) radius_, SDL2gfxColorToUint32(color_));
+        vertices_.push_back({center, color, {0, 0}});
+        for (int i = 0; i < CIRCLE_BATCH_SEGMENTS; i++) {
+            vertices_.push_back({{center.x + circleTable_[i].x * radius, center.y + circleTable_[i].y * radius}, color, {0, 0}});
+        }
+
+        for (int i = 0; i < CIRCLE_BATCH_SEGMENTS; i++) {
+            indices_.push_back(centerIdx);
+            indices_.push_back(centerIdx + 1 + i);
+            indices_.push_back(centerIdx + 1 + (i + 1) % CIRCLE_BATCH_SEGMENTS);
+        }
     }
-};
 
-class MGSquare : public MGShape {
-    int length_;
+    void addSquare(const SDL_FPoint &center, float length, const SDL_Color &color) {
+        int firstIdx = (int) vertices_.size();
+        float half = length / 2;
 
-public:
-    MGSquare(const SDL_Point &position, const int length, const SDL_Color &color):
-        MGShape(position, color), length_(length) {};
+        vertices_.push_back({{center.x - half, center.y - half}, color, {0, 0}});
+        vertices_.push_back({{center.x + half, center.y - half}, color, {0, 0}});
+        vertices_.push_back({{center.x + half, center.y + half}, color, {0, 0}});
+        vertices_.push_back({{center.x - half, center.y + half}, color, {0, 0}});
+
+        const int quadIndices[] = {0, 1, 2, 0, 2, 3};
+        for (int idx : quadIndices) indices_.push_back(firstIdx + idx);
+    }
+
+    // Textured quad over a SpriteCache atlas region, centered on `center`.
+    void addSprite(const SDL_FPoint &center, const SDL_Rect &sprite) {
+        int firstIdx = (int) vertices_.size();
+
+        float left = center.x - (float) (sprite.w / 2);
+        float top = center.y - (float) (sprite.h / 2);
+        float u0 = (float) sprite.x / SPRITE_ATLAS_SIZE;
+        float v0 = (float) sprite.y / SPRITE_ATLAS_SIZE;
+        float u1 = (float) (sprite.x + sprite.w) / SPRITE_ATLAS_SIZE;
+        float v1 = (float) (sprite.y + sprite.h) / SPRITE_ATLAS_SIZE;
 
-    void draw(SDL_Renderer* renderer) const override {
-        RendererGuard rendererGuard(renderer);
+        vertices_.push_back({{left, top}, WHITE_SDL_COLOR, {u0, v0}});
+        vertices_.push_back({{left + sprite.w, top}, WHITE_SDL_COLOR, {u1, v0}});
+        vertices_.push_back({{left + sprite.w, top + sprite.h}, WHITE_SDL_COLOR, {u1, v1}});
+        vertices_.push_back({{left, top + sprite.h}, WHITE_SDL_COLOR, {u0, v1}});
 
-        SDL_Rect square = {position_.x - length_ / 2, position_.y - length_ / 2, length_, length_};
-        SDL_SetRenderDrawColor(renderer, color_.r, color_.g, color_.b, color_.a);
-        SDL_RenderFillRect(renderer, &square);
+        const int quadIndices[] = {0, 1, 2, 0, 2, 3};
+        for (int idx : quadIndices) indices_.push_back(firstIdx + idx);
+    }
+
+    void draw(SDL_Renderer* renderer, SDL_Texture *texture=nullptr) const {
+        assert(renderer);
+        if (indices_.empty()) return;
+
+        SDL_RenderGeometry(renderer, texture, vertices_.data(), (int) vertices_.size(), indices_.data(), (int) indices_.size());
     }
 };
 
@@ -76,6 +124,8 @@ class ReactorWallWidget : public Widget {
     double systemSummaryEnergy_ = 1;
     Uint8 redColorPart = 0;
 
+    DynamicOverlay<Uint8> colorOverlay_;
+
 public:
     ReactorWallWidget(int width, int height, Widget *parent=nullptr): Widget(width, height, parent) {}
 
@@ -83,7 +133,7 @@ public:
         currentEnergy_ = currentEnergy;
         systemSummaryEnergy_ = systemSummaryEnergy;
         redColorPart = std::clamp((int) (255 * currentEnergy_ * REACTOR_WALL_TEMPERATURE_COLOR_COEF), 0, 255);
-        setRerenderFlag();
+        if (colorOverlay_.update(redColorPart)) setRerenderFlag();
     }
 
     void renderSelfAction(SDL_Renderer* renderer) override {
@@ -97,14 +147,24 @@ public:
 
 class ReactorCanvas : public Container {
     bool needReCalc_ = false;
+    bool needReInterpolate_ = false;
     bool needReSize_ = false;
     bool needExplode_ = false;
     
     int reactorWidth_;
     int reactorHeight_;
-    ReactorModel reactorModel_;
+    ReactorSimulation simulation_;
+    std::unique_ptr<TrajectoryReader> replay_ = nullptr;
+    bool replaySamplePending_ = false;
+    double interpolation_ = 1;
+
+    unsigned long long nextSampleStep_ = 0;
+    bool sampleStepKnown_ = false;
     
-    std::vector<MGShape *> geomPrimitives_ = {};
+    MGShapeBatch circlitsBatch_;
+    MGShapeBatch circlitSpritesBatch_;
+    MGShapeBatch quadritsBatch_;
+    unsigned long long spriteGeneration_ = 0;
     ReactorWallWidget *leftWall     = nullptr;  
     ReactorWallWidget *rightWall    = nullptr; 
     ReactorWallWidget *topWall      = nullptr;
@@ -148,9 +208,11 @@ private:
     }
 
     void explodeReactor(SDL_Renderer* renderer) { 
-        for (int i = 0; i < EXPLODE_PARTICLES_NUM; i++) {
-            addCirclit();
-        }
+        simulation_.post([](ReactorModel &model) {
+            for (int i = 0; i < EXPLODE_PARTICLES_NUM; i++) {
+                model.addCirclit();
+            }
+        });
         needExplode_ = false;
     }
 
@@ -158,71 +220,150 @@ public:
     ReactorCanvas
     (
         int width, int height,
-        std::function<void()> onReactorUpdate,
+        int stepDelayMS,
         Widget *parent=nullptr
     ) : 
         Container(width, height, parent),
         reactorWidth_(width - 2 * REACTOR_WALL_WIDTH),
         reactorHeight_(height - 2 * REACTOR_WALL_WIDTH),
-        reactorModel_(reactorWidth_, reactorHeight_, onReactorUpdate)
+        simulation_(reactorWidth_, reactorHeight_, stepDelayMS)
     {
         createReactorWalls();  
     }
 
-    ~ReactorCanvas() override {
-        for (MGShape *shape : geomPrimitives_) delete shape;
+    const ReactorSnapshot &snapshot() const { return (replay_ ? replay_->snapshot() : simulation_.snapshot()); }
+    int stepDelayMS() const { return (replay_ ? replay_->stepDelayMS() : simulation_.stepDelayMS()); }
+
+    // While a replay is loaded, frames come from it at the recorded step rate
+    // and the live simulation keeps running unseen.
+    bool pollSimulation() {
+        simulation_.releaseRetiredObservers();
+
+        if (replay_) {
+            using namespace std::chrono;
+
+            // The live samples are not what is shown.
+            ReactorSample liveSample;
+            while (simulation_.popSample(liveSample)) {}
+
+            if (steady_clock::now() - replay_->snapshot().time < milliseconds(stepDelayMS())) return false;
+            if (!replay_->next()) return false;
+            replaySamplePending_ = true;
+        } else if (!simulation_.acquireSnapshot()) {
+            return false;
+        }
+        
+        interpolation_ = 0;
+        setRecalcFlag();
+        return true;
+    }
+
+    // Every step since the last call in order, or the replayed frames. Steps
+    // that never reached here are reported, so a recorder gap is never silent.
+    bool popSample(ReactorSample &sample) {
+        if (replay_) {
+            if (!replaySamplePending_) return false;
+            sample = replay_->snapshot();
+            replaySamplePending_ = false;
+        } else if (!simulation_.popSample(sample)) {
+            return false;
+        }
+
+        if (sampleStepKnown_ && sample.step > nextSampleStep_) {
+            fprintf(stderr, "ReactorCanvas: steps %llu-%llu were not recorded\n", nextSampleStep_, sample.step - 1);
+        }
+        nextSampleStep_ = sample.step + 1;
+        sampleStepKnown_ = true;
+        return true;
     }
 
-    ReactorModel *reactorModel() { return &reactorModel_; }
+    // Draws molecules between the previous and the current step, `alpha` of the way.
+    void interpolate(double alpha) {
+        alpha = std::clamp(alpha, 0.0, 1.0);
+        if (alpha == interpolation_) return;
+
+        interpolation_ = alpha;
+        needReInterpolate_ = true;
+    }
+
+    void interpolateToNow() {
+        using namespace std::chrono;
+
+        double sinceStepMS = duration<double, std::milli>(steady_clock::now() - snapshot().time).count();
+        interpolate(sinceStepMS / stepDelayMS());
+    }
 
     void setRecalcFlag() { needReCalc_ = true; }
     void setUpdateSizeFlag() { needReSize_ = true; }
 
-    void recalculateMoleculePrimitives() {
-        for (auto primitive : geomPrimitives_) delete primitive;
-        geomPrimitives_.clear();
+    void recalculateMoleculePrimitives() { recalculateMoleculePrimitives(snapshot()); }
+
+    void recalculateMoleculePrimitives(const ReactorSnapshot &snapshot) {
+        PROFILE_SCOPE("ReactorCanvas::recalculateMoleculePrimitives");
+
+        circlitsBatch_.clear();
+        circlitSpritesBatch_.clear();
+        quadritsBatch_.clear();
+
+        // Every molecule is one quad once its sprite exists; the geometry
+        // circles are only a stopgap and are left to grow on their own.
+        size_t circlits = std::count_if(snapshot.molecules.begin(), snapshot.molecules.end(),
+            [](const MoleculeSnapshot &molecule) { return molecule.type == MoleculeTypes::CIRCLIT; });
+        size_t quadrits = snapshot.molecules.size() - circlits;
+        circlitSpritesBatch_.reserve(4 * circlits, 6 * circlits);
+        quadritsBatch_.reserve(4 * quadrits, 6 * quadrits);
 
-        for (auto molecule : reactorModel_.getMolecules()) {
-            MGShape *curPrimitive = nullptr;
+        SpriteCache &spriteCache = shapeSpriteCache();
+
+        for (const MoleculeSnapshot &molecule : snapshot.molecules) {
+            double x = molecule.prevX + (molecule.x - molecule.prevX) * interpolation_;
+            double y = molecule.prevY + (molecule.y - molecule.prevY) * interpolation_;
+            SDL_FPoint center = {(float) x + REACTOR_WALL_WIDTH, (float) y + REACTOR_WALL_WIDTH};
         
-            switch (molecule->getType()) {
-    
-                case MoleculeTypes::CIRCLIT:
-                    curPrimitive = (MGShape *) new MGCircle(
-                        {(int) molecule->getPosition().get_x() + REACTOR_WALL_WIDTH, (int) molecule->getPosition().get_y() + REACTOR_WALL_WIDTH},
-                        molecule->getSize(), CIRCLIT_COLOR);
+            switch (molecule.type) {
     
-                    geomPrimitives_.push_back(curPrimitive);
+                case MoleculeTypes::CIRCLIT: {
+                    SpriteKey key = {SpriteShape::CIRCLE, (int) molecule.size, CIRCLIT_COLOR};
+                    const SDL_Rect *sprite = spriteCache.find(key);
+
+                    if (sprite) {
+                        circlitSpritesBatch_.addSprite(center, *sprite);
+                    } else {
+                        // Not rasterized yet: draw as geometry until the next render binds the cache.
+                        spriteCache.request(key);
+                        circlitsBatch_.addCircle(center, (float) molecule.size, CIRCLIT_COLOR);
+                    }
                     break;
+                }
                 case MoleculeTypes::QUADRIT:
-                    curPrimitive = (MGShape *) new MGSquare(
-                        {(int) molecule->getPosition().get_x() + REACTOR_WALL_WIDTH, (int) molecule->getPosition().get_y() + REACTOR_WALL_WIDTH},
-                        molecule->getSize(), QUADRIT_COLOR);
-        
-                    geomPrimitives_.push_back(curPrimitive);
+                    quadritsBatch_.addSquare(center, (float) molecule.size, QUADRIT_COLOR);
                     break;
                 default:
                     assert(0 && "ReactorCanvas update() : unknown moleculeType");
                     break;
             }
         }
+        spriteGeneration_ = spriteCache.generation();
         needReCalc_ = false;
     }
 
     void recalculateWallsEnergy() {
-        leftWall->setWallEnergyPair(reactorModel_.getReactorWalls()[LEFT_WALL].energy, reactorModel_.getSummaryEnergy());
-        rightWall->setWallEnergyPair(reactorModel_.getReactorWalls()[RIGHT_WALL].energy, reactorModel_.getSummaryEnergy());
-        bottomWall->setWallEnergyPair(reactorModel_.getReactorWalls()[BOTTOM_WALL].energy, reactorModel_.getSummaryEnergy());
-        topWall->setWallEnergyPair(reactorModel_.getReactorWalls()[TOP_WALL].energy, reactorModel_.getSummaryEnergy());
+        const ReactorSnapshot &snapshot = this->snapshot();
+
+        leftWall->setWallEnergyPair(snapshot.wallsEnergy[LEFT_WALL], snapshot.summaryEnergy);
+        rightWall->setWallEnergyPair(snapshot.wallsEnergy[RIGHT_WALL], snapshot.summaryEnergy);
+        bottomWall->setWallEnergyPair(snapshot.wallsEnergy[BOTTOM_WALL], snapshot.summaryEnergy);
+        topWall->setWallEnergyPair(snapshot.wallsEnergy[TOP_WALL], snapshot.summaryEnergy);
     }
 
     bool updateSelfAction() override {
-        if (!(needReCalc_ || needReSize_)) return false;
+        if (!(needReCalc_ || needReInterpolate_ || needReSize_)) return false;
 
         if (needReSize_) recalculateReactorCanvasSize();
-        if (needReCalc_) {
+        if (needReCalc_) recalculateWallsEnergy();
+        if (needReCalc_ || needReInterpolate_) {
             recalculateMoleculePrimitives();
-            recalculateWallsEnergy();
+            needReInterpolate_ = false;
         }
         
         setRerenderFlag();
@@ -231,10 +372,10 @@ public:
     }
 
     void showInfo() {
-        std::cout << "SummaryEnergy : " << reactorModel_.getSummaryEnergy() << "\n";
+        std::cout << "SummaryEnergy : " << snapshot().summaryEnergy << "\n";
         
-        for (size_t i = 0; i < 4; i++) {
-            std::cout << "wall[" << i << "].energy = " << reactorModel_.getReactorWalls()[i].energy << ", ";
+        for (size_t i = 0; i < REACTOR_WALLS_COUNT; i++) {
+            std::cout << "wall[" << i << "].energy = " << snapshot().wallsEnergy[i] << ", ";
         }
         std::cout << "\n\n";
 
@@ -252,6 +393,7 @@ public:
     }
 
     void renderSelfAction(SDL_Renderer* renderer) override {
+        PROFILE_SCOPE("ReactorCanvas::renderSelfAction");
         assert(renderer);
         
         // showInfo();
@@ -260,36 +402,83 @@ public:
         SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255); // MGCanvas BACKGROUND COLOR
         SDL_RenderFillRect(renderer, &widgetRect);
 
-        for (auto shape : geomPrimitives_) {
-            shape->draw(renderer);
-        }
+        SpriteCache &spriteCache = shapeSpriteCache();
+        spriteCache.bind(renderer);
+        // Binding may have cleared the atlas under the sprite rects of this frame.
+        if (spriteCache.generation() != spriteGeneration_) recalculateMoleculePrimitives();
+
+        circlitsBatch_.draw(renderer);
+        circlitSpritesBatch_.draw(renderer, spriteCache.texture());
+        quadritsBatch_.draw(renderer);
     }
 
     void addCirclit() {
-        reactorModel_.addCirclit();
+        simulation_.post([](ReactorModel &model) { model.addCirclit(); });
     }
     void addQuadrit() {
-        reactorModel_.addQuadrit();
+        simulation_.post([](ReactorModel &model) { model.addQuadrit(); });
     }
     void removeMolecule() {
-        reactorModel_.removeMolecule();
+        simulation_.post([](ReactorModel &model) { model.removeMolecule(); });
     }
     void narrowRightWall() {
-        reactorModel_.narrowRightWall(NARROWING_DELTA);
+        simulation_.post([](ReactorModel &model) { model.narrowRightWall(NARROWING_DELTA); });
         reactorWidth_ = std::max(MIN_REACTOR_SIZE, reactorWidth_ - NARROWING_DELTA);
         setUpdateSizeFlag();
     }
     void unNarrowRightWall() {
-        reactorModel_.narrowRightWall(-NARROWING_DELTA);
+        simulation_.post([](ReactorModel &model) { model.narrowRightWall(-NARROWING_DELTA); });
         reactorWidth_ = std::max(MIN_REACTOR_SIZE, reactorWidth_ + NARROWING_DELTA);
         
         setUpdateSizeFlag();
     }
 
-    void heatTopWall() { reactorModel_.addEnergyToWall(TOP_WALL, /*percantage*/ 5); }
-    void heatRightWall() { reactorModel_.addEnergyToWall(RIGHT_WALL, /*percantage*/ 5); }
-    void heatLeftWall() { reactorModel_.addEnergyToWall(LEFT_WALL, /*percantage*/ 5); }
-    void heatBottomWall() { reactorModel_.addEnergyToWall(BOTTOM_WALL, /*percantage*/ 5); }
+    void heatTopWall() { heatWall(TOP_WALL); }
+    void heatRightWall() { heatWall(RIGHT_WALL); }
+    void heatLeftWall() { heatWall(LEFT_WALL); }
+    void heatBottomWall() { heatWall(BOTTOM_WALL); }
+    // Writes every simulation step to a trajectory file until stopped.
+    bool recordTrajectory(const char *path) {
+        std::shared_ptr<TrajectoryWriter> writer = std::make_shared<TrajectoryWriter>();
+        if (!writer->open(path, simulation_.stepDelayMS())) return false;
+
+        simulation_.setSnapshotObserver([writer](const ReactorSnapshot &snapshot) { writer->push(snapshot); });
+        return true;
+    }
+    void stopTrajectory() { simulation_.setSnapshotObserver(nullptr); }
+
+    bool replayTrajectory(const char *path) {
+        std::unique_ptr<TrajectoryReader> replay = std::make_unique<TrajectoryReader>();
+        if (!replay->open(path)) return false;
+
+        replay_ = std::move(replay);
+        replaySamplePending_ = true;
+        sampleStepKnown_ = false;
+        setRecalcFlag();
+        return true;
+    }
+    // Jumps to the keyframe `fraction` of the way through the replay.
+    bool seekReplay(double fraction) {
+        if (!replay_) return false;
+
+        size_t keyframe = (size_t) std::lround(std::clamp(fraction, 0.0, 1.0) * (replay_->keyframesCount() - 1));
+        if (!replay_->seekKeyframe(keyframe)) return false;
+
+        replaySamplePending_ = true;
+        sampleStepKnown_ = false;
+        interpolation_ = 0;
+        setRecalcFlag();
+        return true;
+    }
+    void stopReplay() {
+        replay_ = nullptr;
+        replaySamplePending_ = false;
+        sampleStepKnown_ = false;
+        setRecalcFlag();
+    }
+    TrajectoryReader *replay() { return replay_.get(); }
+
+    void heatWall(int wall) { simulation_.post([wall](ReactorModel &model) { model.addEnergyToWall(wall, /*percantage*/ 5); }); }
     
     void setExplodeReactorFlag() { needExplode_ = true; }
 };
@@ -323,8 +512,9 @@ class ReactorGUI : public Window {
 
     ReactorButtonTexturePack texturePack_ = {};
 
-    ReactorModel *reactorModel_ = nullptr;
     ReactorCanvas *reactorCanvas_ = nullptr;
+    std::function<void()> onReactorUpdate_ = nullptr;
+    ReactorSample sample_ = {};
 
 private:
     Container *createReactorButtonPanel(int width, int height) {
@@ -411,7 +601,8 @@ public:
     ReactorGUI(int width, int height, ReactorButtonTexturePack texturePack, std::function<void()> onReactorUpdate=nullptr, int reactorUpdateDelayMS=40): 
         Window(width, height),
         texturePack_(texturePack),
-        reactorUpdateDelayMS_(reactorUpdateDelayMS)
+        reactorUpdateDelayMS_(reactorUpdateDelayMS),
+        onReactorUpdate_(onReactorUpdate)
     {
         reactorCanvasWidth_ = width - 2 * WINDOW_BORDER_SIZE;
         reactorCanvasHeight_ = (height - 3 * WINDOW_BORDER_SIZE) * REACTOR_CANVAS_SHARE;
@@ -419,11 +610,10 @@ public:
         buttonPanelHeight_ = height - 3 * WINDOW_BORDER_SIZE - reactorCanvasHeight_;
     
         ReactorVisibleArea *reactorVisibleArea = new ReactorVisibleArea(reactorCanvasWidth_, reactorCanvasHeight_, this);
-        reactorCanvas_ = new ReactorCanvas(reactorCanvasWidth_, reactorCanvasHeight_, onReactorUpdate, reactorVisibleArea);
+        reactorCanvas_ = new ReactorCanvas(reactorCanvasWidth_, reactorCanvasHeight_, reactorUpdateDelayMS_, reactorVisibleArea);
         
         
         reactorVisibleArea->addWidget(0, 0, reactorCanvas_);
-        reactorModel_ = reactorCanvas_->reactorModel();
 
         Container *ButtonPanel = createReactorButtonPanel(buttonPanelWidth_, buttonPanelHeight_);
     
@@ -439,22 +629,32 @@ public:
         SDL_RenderFillRect(renderer, &full);
     }
 
-    void setReactorOnUpdate(std::function<void()> updateFunc) { reactorModel_->setOnUpdate(updateFunc); }
+    // Called from the UI thread once for every simulation step, oldest first;
+    // the getters below return the values of that step.
+    void setReactorOnUpdate(std::function<void()> updateFunc) { onReactorUpdate_ = updateFunc; }
 
-    int getReactorCirclitCount() { return reactorModel_->getCirclitCount(); }
-    int getReactorQuadritCount() { return reactorModel_->getQuadritCount(); }
-    double getReactorSummaryEnergy() { return reactorModel_->getSummaryEnergy(); }
+    int getReactorCirclitCount() { return sample_.circlitCount; }
+    int getReactorQuadritCount() { return sample_.quadritCount; }
+    double getReactorSummaryEnergy() { return sample_.summaryEnergy; }
+    double getReactorWallEnergy(int wall) { return sample_.wallsEnergy[wall]; }
+    double getReactorTime() { return (double) sample_.step * reactorCanvas_->stepDelayMS() / SEC_TO_MS; }
 
-    void updateReactor(int deltaMS) {
-        static int passedDeltaMS = 0;
+    bool recordTrajectory(const char *path) { return reactorCanvas_->recordTrajectory(path); }
+    bool replayTrajectory(const char *path) { return reactorCanvas_->replayTrajectory(path); }
+    bool seekReplay(double fraction) { return reactorCanvas_->seekReplay(fraction); }
+    TrajectoryReader *replay() { return reactorCanvas_->replay(); }
 
-        passedDeltaMS += deltaMS;
+    // The model is stepped on its own thread; here we pick up the latest
+    // snapshot, move molecules towards it at display rate and hand every
+    // step since the last frame to onReactorUpdate_.
+    void updateReactor(int deltaMS) {
+        PROFILE_SCOPE("ReactorGUI::updateReactor");
 
-        if (passedDeltaMS >= reactorUpdateDelayMS_) {
-            reactorModel_->update(double(reactorUpdateDelayMS_) / SEC_TO_MS);
-            reactorCanvas_->setRecalcFlag();
-            passedDeltaMS -= reactorUpdateDelayMS_;
+        reactorCanvas_->pollSimulation();
+        while (reactorCanvas_->popSample(sample_)) {
+            if (onReactorUpdate_) onReactorUpdate_();
         }
+        reactorCanvas_->interpolateToNow();
     }
     
     int reactorUpdateDelayMS() const { return reactorUpdateDelayMS_; }
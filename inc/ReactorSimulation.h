@@ -0,0 +1,259 @@
+#ifndef REACTOR_SIMULATION_H
+#define REACTOR_SIMULATION_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "ReactorModel.h"
+#include "Profiler.h"
+
+const int REACTOR_WALLS_COUNT = 4;
+const size_t REACTOR_SAMPLES_CAPACITY = 1024;
+
+struct MoleculeSnapshot {
+    double x, y;
+    double prevX, prevY;    // position one step earlier, for render interpolation
+    double size;
+    MoleculeTypes type;
+    const void *id;         // the model's molecule, only ever compared
+};
+
+// Scalar state of one step; recorders get one of these for every step.
+struct ReactorSample {
+    double wallsEnergy[REACTOR_WALLS_COUNT] = {};
+    double summaryEnergy = 0;
+    int circlitCount = 0;
+    int quadritCount = 0;
+    unsigned long long step = 0;
+};
+
+struct ReactorSnapshot : ReactorSample {
+    std::vector<MoleculeSnapshot> molecules;
+    std::chrono::steady_clock::time_point time = {};
+};
+
+// Single producer / single consumer triple buffer: the writer always owns one
+// slot, the reader owns another, and the third is exchanged atomically.
+template <typename T>
+class TripleBuffer {
+    static constexpr int INDEX_MASK = 0b011;
+    static constexpr int FRESH_BIT  = 0b100;
+
+    T slots_[3] = {};
+    std::atomic<int> middle_ = 1;
+    int back_ = 2;
+    int front_ = 0;
+
+public:
+    T &back() { return slots_[back_]; }
+    const T &front() const { return slots_[front_]; }
+
+    void publish() {
+        int prev = middle_.exchange(back_ | FRESH_BIT, std::memory_order_acq_rel);
+        back_ = prev & INDEX_MASK;
+    }
+
+    bool acquire() {
+        if (!(middle_.load(std::memory_order_acquire) & FRESH_BIT)) return false;
+
+        int prev = middle_.exchange(front_, std::memory_order_acq_rel);
+        front_ = prev & INDEX_MASK;
+        return true;
+    }
+};
+
+// Single producer / single consumer bounded queue. push() fails instead of
+// waiting when the consumer falls behind.
+template <typename T, size_t CAPACITY>
+class SpscQueue {
+    static_assert((CAPACITY & (CAPACITY - 1)) == 0, "CAPACITY must be a power of two");
+
+    T slots_[CAPACITY] = {};
+    std::atomic<size_t> head_ = 0;  // next to pop, written by the consumer
+    std::atomic<size_t> tail_ = 0;  // next to push, written by the producer
+
+public:
+    bool push(const T &value) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) == CAPACITY) return false;
+
+        slots_[tail % CAPACITY] = value;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T &value) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) return false;
+
+        value = slots_[head % CAPACITY];
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+};
+
+class ReactorSimulation {
+public:
+    using Command = std::function<void(ReactorModel &)>;
+    using SnapshotObserver = std::function<void(const ReactorSnapshot &)>;
+
+private:
+    ReactorModel model_;
+    std::chrono::milliseconds stepDelay_;
+
+    TripleBuffer<ReactorSnapshot> snapshots_;
+    SpscQueue<ReactorSample, REACTOR_SAMPLES_CAPACITY> samples_;
+    unsigned long long stepsCount_ = 0;
+
+    // Previous step's molecules by id, reused between steps.
+    std::unordered_map<const void *, MoleculeSnapshot> prevMolecules_ = {};
+
+    std::mutex commandsMutex_;
+    std::vector<Command> pendingCommands_ = {};
+    std::vector<Command> runningCommands_ = {};
+
+    SnapshotObserver snapshotObserver_ = nullptr;
+    std::vector<SnapshotObserver> retiredObservers_ = {};   // guarded by commandsMutex_
+
+    std::atomic<bool> running_ = false;
+    std::thread thread_;
+
+private:
+    void runCommands() {
+        PROFILE_SCOPE("ReactorSimulation::runCommands");
+        {
+            std::lock_guard<std::mutex> lock(commandsMutex_);
+            std::swap(pendingCommands_, runningCommands_);
+        }
+
+        for (Command &command : runningCommands_) command(model_);
+        runningCommands_.clear();
+    }
+
+    void writeSnapshot() {
+        PROFILE_SCOPE("ReactorSimulation::writeSnapshot");
+        ReactorSnapshot &snapshot = snapshots_.back();
+
+        // Molecules that existed a step ago move on from where they were, new
+        // ones (by commands or by reactions in update()) appear in place. An
+        // address freed and reused within one step is told apart by its shape.
+        snapshot.molecules.clear();
+        for (auto molecule : model_.getMolecules()) {
+            double x = molecule->getPosition().get_x();
+            double y = molecule->getPosition().get_y();
+            MoleculeSnapshot current = {x, y, x, y, (double) molecule->getSize(), molecule->getType(), &*molecule};
+
+            auto prev = prevMolecules_.find(current.id);
+            if (prev != prevMolecules_.end() && prev->second.type == current.type && prev->second.size == current.size) {
+                current.prevX = prev->second.x;
+                current.prevY = prev->second.y;
+            }
+            snapshot.molecules.push_back(current);
+        }
+
+        prevMolecules_.clear();
+        for (const MoleculeSnapshot &molecule : snapshot.molecules) prevMolecules_.emplace(molecule.id, molecule);
+
+        for (int i = 0; i < REACTOR_WALLS_COUNT; i++) {
+            snapshot.wallsEnergy[i] = model_.getReactorWalls()[i].energy;
+        }
+        snapshot.summaryEnergy = model_.getSummaryEnergy();
+        snapshot.circlitCount = model_.getCirclitCount();
+        snapshot.quadritCount = model_.getQuadritCount();
+        snapshot.step = stepsCount_;
+        snapshot.time = std::chrono::steady_clock::now();
+
+        if (snapshotObserver_) snapshotObserver_(snapshot);
+        samples_.push(snapshot);
+        snapshots_.publish();
+    }
+
+    void run() {
+        const double dt = std::chrono::duration<double>(stepDelay_).count();
+        auto nextStep = std::chrono::steady_clock::now();
+        PROFILE_THREAD_NAME("simulation");
+
+        while (running_.load(std::memory_order_relaxed)) {
+            PROFILE_SCOPE("ReactorSimulation::step");
+
+            runCommands();
+            {
+                PROFILE_SCOPE("ReactorModel::update");
+                model_.update(dt);
+            }
+            stepsCount_++;
+            writeSnapshot();
+
+            // A slow step drops the missed ticks instead of running a burst to catch up.
+            nextStep = std::max(nextStep + stepDelay_, std::chrono::steady_clock::now());
+            std::this_thread::sleep_until(nextStep);
+        }
+    }
+
+public:
+    ReactorSimulation(double width, double height, int stepDelayMS):
+        model_(width, height, [] {}), stepDelay_(stepDelayMS)
+    {
+        writeSnapshot();
+        snapshots_.acquire();
+
+        running_ = true;
+        thread_ = std::thread([this] { run(); });
+    }
+
+    ~ReactorSimulation() {
+        running_ = false;
+        if (thread_.joinable()) thread_.join();
+    }
+
+    ReactorSimulation(const ReactorSimulation &) = delete;
+    ReactorSimulation &operator=(const ReactorSimulation &) = delete;
+
+    // Command is executed on the simulation thread before the next step.
+    void post(Command command) {
+        std::lock_guard<std::mutex> lock(commandsMutex_);
+        pendingCommands_.push_back(std::move(command));
+    }
+
+    // Observer is called on the simulation thread with every snapshot before
+    // it is published; nullptr removes it. The replaced observer is handed
+    // back and destroyed by releaseRetiredObservers(), so whatever it owns
+    // (e.g. a file flush) never runs on the simulation thread.
+    void setSnapshotObserver(SnapshotObserver observer) {
+        post([this, observer](ReactorModel &) {
+            SnapshotObserver retired = std::move(snapshotObserver_);
+            snapshotObserver_ = observer;
+
+            std::lock_guard<std::mutex> lock(commandsMutex_);
+            if (retired) retiredObservers_.push_back(std::move(retired));
+        });
+    }
+
+    // UI thread only.
+    void releaseRetiredObservers() {
+        std::vector<SnapshotObserver> retired;
+        {
+            std::lock_guard<std::mutex> lock(commandsMutex_);
+            std::swap(retired, retiredObservers_);
+        }
+    }
+
+    // UI thread only. Returns true if a newer snapshot became current.
+    bool acquireSnapshot() { return snapshots_.acquire(); }
+    const ReactorSnapshot &snapshot() const { return snapshots_.front(); }
+
+    // UI thread only. Pops the samples of all steps in order; if the UI stalls
+    // for more than REACTOR_SAMPLES_CAPACITY steps, the newest ones are lost
+    // and the gap shows up in their step numbers.
+    bool popSample(ReactorSample &sample) { return samples_.pop(sample); }
+
+    int stepDelayMS() const { return (int) stepDelay_.count(); }
+};
+
+#endif // REACTOR_SIMULATION_H
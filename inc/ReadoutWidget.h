@@ -0,0 +1,83 @@
+#ifndef READOUT_WIDGET_H
+#define READOUT_WIDGET_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "MyGUI.h"
+#include "GlyphAtlas.h"
+
+
+// Column of "label  value" lines for live numbers. Text goes through a glyph
+// atlas, so a new value costs a shaped-string lookup instead of a TTF
+// rasterization, and all lines are drawn in one call.
+class ReadoutWindow : public Window {
+    static constexpr const int FONT_SIZE = 12;
+    static constexpr const int TEXT_PADDING = 4;
+    static constexpr const int VALUE_PRECISION = 6;
+    static constexpr const int VALUE_BUFFER_SIZE = 32;
+
+    static constexpr const SDL_Color LABEL_COLOR = {200, 200, 200, 255};
+
+    struct Readout {
+        std::string label;
+        std::string value;
+        SDL_Color color;
+    };
+
+    TTF_Font* font_ = nullptr;
+    GlyphAtlas atlas_;
+
+    std::vector<Readout> readouts_ = {};
+
+public:
+    ReadoutWindow(int width, int height, const char fontPath[], Widget *parent=nullptr): Window(width, height, parent) {
+        font_ = TTF_OpenFont(fontPath, FONT_SIZE);
+        if (!font_) {
+            SDL_Log("TTF_OpenFont: %s", TTF_GetError());
+            assert(0);
+        }
+        atlas_.build(font_);
+    }
+
+    ~ReadoutWindow() override { TTF_CloseFont(font_); }
+
+    size_t addReadout(const char *label, const SDL_Color &color) {
+        readouts_.push_back({label, "-", color});
+        setRerenderFlag();
+        return readouts_.size() - 1;
+    }
+
+    void setValue(size_t idx, double value) {
+        assert(idx < readouts_.size());
+
+        char text[VALUE_BUFFER_SIZE] = "";
+        snprintf(text, sizeof(text), "%.*g", VALUE_PRECISION, value);
+
+        if (readouts_[idx].value == text) return;
+        readouts_[idx].value = text;
+        setRerenderFlag();
+    }
+
+    void renderSelfAction(SDL_Renderer* renderer) override {
+        assert(renderer);
+
+        SDL_SetRenderDrawColor(renderer, DEFAULT_WINDOW_COLOR.r, DEFAULT_WINDOW_COLOR.g, DEFAULT_WINDOW_COLOR.b, DEFAULT_WINDOW_COLOR.a);
+        SDL_Rect full = {0, 0, rect_.w, rect_.h};
+        SDL_RenderFillRect(renderer, &full);
+
+        int y = TEXT_PADDING;
+        for (const Readout &readout : readouts_) {
+            int valueWidth = atlas_.shape(readout.value).width;
+
+            atlas_.queue(readout.label, TEXT_PADDING, y, LABEL_COLOR);
+            atlas_.queue(readout.value, rect_.w - TEXT_PADDING - valueWidth, y, readout.color);
+            y += atlas_.lineHeight();
+        }
+        atlas_.flush(renderer);
+    }
+};
+
+
+#endif // READOUT_WIDGET_H
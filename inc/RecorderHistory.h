@@ -0,0 +1,276 @@
+#ifndef RECORDER_HISTORY_H
+#define RECORDER_HISTORY_H
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const char RECORDER_HISTORY_MAGIC[4] = {'R', 'C', 'H', 'S'};
+const uint32_t RECORDER_HISTORY_VERSION = 1;
+const size_t RECORDER_HISTORY_HEADER_SIZE = 4096;
+const size_t RECORDER_HISTORY_MAX_CHANNELS = 64;
+const size_t RECORDER_HISTORY_NAME_LEN = 48;
+const size_t RECORDER_HISTORY_GROW_SIZE = 64 << 20;
+const size_t RECORDER_HISTORY_PREFAULT_SIZE = 1 << 20;
+const std::chrono::milliseconds RECORDER_HISTORY_AHEAD_PERIOD(10);
+const size_t RECORDER_HISTORY_MAX_SIZE = 1ull << 36;   // address space reserved per file
+
+// File layout (native little-endian): one page of header, then fixed-size
+// records of a double timestamp followed by one double per channel.
+struct RecorderHistoryHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t channelsCount;
+    uint32_t recordSize;
+    uint64_t recordsCount;
+    char channelNames[RECORDER_HISTORY_MAX_CHANNELS][RECORDER_HISTORY_NAME_LEN];
+};
+
+static_assert(sizeof(RecorderHistoryHeader) <= RECORDER_HISTORY_HEADER_SIZE);
+
+// Append-only history backed by a memory-mapped file. The whole of
+// RECORDER_HISTORY_MAX_SIZE is mapped once, so the mapping never moves, and
+// appending is a memcpy into it. A background thread polls the write offset
+// and keeps ahead of it: it extends the file RECORDER_HISTORY_GROW_SIZE at a
+// time and faults in the next RECORDER_HISTORY_PREFAULT_SIZE of pages, so
+// the UI thread neither resizes the file, takes first-touch page faults nor
+// makes a system call.
+class RecorderHistoryFile {
+    int fd_ = -1;
+    std::string path_ = {};
+    char *mapping_ = nullptr;
+    size_t recordSize_ = 0;
+    uint64_t recordsCount_ = 0;
+    bool full_ = false;
+
+    // File size the appends may write up to, published by the ahead thread,
+    // and the offset of the next append, published by the UI thread.
+    std::atomic<size_t> fileSize_ = 0;
+    std::atomic<size_t> writeOffset_ = 0;
+
+    std::thread aheadThread_;
+    std::mutex aheadMutex_;
+    std::condition_variable aheadCondition_;
+    bool stopping_ = false;         // guarded by aheadMutex_
+
+    // Ahead thread only.
+    size_t prefaulted_ = 0;
+
+private:
+    RecorderHistoryHeader *header() { return (RecorderHistoryHeader *) mapping_; }
+
+    // Allocates the blocks as well where the filesystem supports it, so that
+    // first writes into the new range don't have to.
+    bool resizeFile(size_t oldSize, size_t newSize) {
+        if (fallocate(fd_, 0, (off_t) oldSize, (off_t) (newSize - oldSize)) == 0) return true;
+        if (errno != EOPNOTSUPP && errno != ENOSYS) return false;
+
+        return ftruncate(fd_, (off_t) newSize) == 0;
+    }
+
+    // Makes [.., target) writable without faults: grows the file if target
+    // comes within half a grow step of its end, then prefaults the pages.
+    bool prepare(size_t target) {
+        size_t fileSize = fileSize_.load(std::memory_order_relaxed);
+
+        if (target + RECORDER_HISTORY_GROW_SIZE / 2 > fileSize && fileSize < RECORDER_HISTORY_MAX_SIZE) {
+            size_t newSize = std::min(fileSize + RECORDER_HISTORY_GROW_SIZE, RECORDER_HISTORY_MAX_SIZE);
+            if (!resizeFile(fileSize, newSize)) {
+                fprintf(stderr, "%s: growing history to %zu bytes: %s\n", path_.c_str(), newSize, strerror(errno));
+                return false;
+            }
+            fileSize = newSize;
+            fileSize_.store(fileSize, std::memory_order_release);
+        }
+
+#ifdef MADV_POPULATE_WRITE
+        size_t pageSize = (size_t) sysconf(_SC_PAGESIZE);
+        size_t end = std::min((target + pageSize - 1) / pageSize * pageSize, fileSize);
+        if (end > prefaulted_ && madvise(mapping_ + prefaulted_, end - prefaulted_, MADV_POPULATE_WRITE) == 0) prefaulted_ = end;
+#endif
+        return true;
+    }
+
+    void runAhead() {
+        std::unique_lock<std::mutex> lock(aheadMutex_);
+
+        while (prepare(writeOffset_.load(std::memory_order_relaxed) + RECORDER_HISTORY_PREFAULT_SIZE)) {
+            if (aheadCondition_.wait_for(lock, RECORDER_HISTORY_AHEAD_PERIOD, [this] { return stopping_; })) return;
+        }
+    }
+
+public:
+    RecorderHistoryFile() = default;
+    RecorderHistoryFile(const RecorderHistoryFile &) = delete;
+    RecorderHistoryFile &operator=(const RecorderHistoryFile &) = delete;
+
+    ~RecorderHistoryFile() { close(); }
+
+    bool open(const char *path, const std::vector<std::string> &channelNames) {
+        assert(path);
+        assert(channelNames.size() <= RECORDER_HISTORY_MAX_CHANNELS);
+        close();
+
+        // An existing history is never overwritten.
+        fd_ = ::open(path, O_RDWR | O_CREAT | O_EXCL, 0644);
+        if (fd_ < 0) {
+            perror(path);
+            return false;
+        }
+        path_ = path;
+
+        size_t initialSize = RECORDER_HISTORY_HEADER_SIZE + RECORDER_HISTORY_GROW_SIZE;
+        if (!resizeFile(0, initialSize)) {
+            perror(path);
+            close();
+            return false;
+        }
+
+        void *mapping = mmap(nullptr, RECORDER_HISTORY_MAX_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (mapping == MAP_FAILED) {
+            perror("RecorderHistoryFile mmap");
+            close();
+            return false;
+        }
+        mapping_ = (char *) mapping;
+
+        recordSize_ = (channelNames.size() + 1) * sizeof(double);
+        recordsCount_ = 0;
+        full_ = false;
+        fileSize_ = initialSize;
+        writeOffset_ = RECORDER_HISTORY_HEADER_SIZE;
+        prefaulted_ = RECORDER_HISTORY_HEADER_SIZE;
+        stopping_ = false;
+
+        RecorderHistoryHeader *hdr = header();
+        memcpy(hdr->magic, RECORDER_HISTORY_MAGIC, sizeof(hdr->magic));
+        hdr->version = RECORDER_HISTORY_VERSION;
+        hdr->channelsCount = (uint32_t) channelNames.size();
+        hdr->recordSize = (uint32_t) recordSize_;
+        hdr->recordsCount = 0;
+        for (size_t i = 0; i < channelNames.size(); i++) {
+            strncpy(hdr->channelNames[i], channelNames[i].c_str(), RECORDER_HISTORY_NAME_LEN - 1);
+        }
+
+        aheadThread_ = std::thread([this] { runAhead(); });
+        return true;
+    }
+
+    void close() {
+        if (fd_ < 0) return;
+
+        if (aheadThread_.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(aheadMutex_);
+                stopping_ = true;
+            }
+            aheadCondition_.notify_one();
+            aheadThread_.join();
+        }
+
+        if (mapping_) munmap(mapping_, RECORDER_HISTORY_MAX_SIZE);
+        if (mapping_ && ftruncate(fd_, (off_t) (RECORDER_HISTORY_HEADER_SIZE + recordsCount_ * recordSize_)) != 0) {
+            perror("RecorderHistoryFile ftruncate");
+        }
+        ::close(fd_);
+
+        fd_ = -1;
+        mapping_ = nullptr;
+    }
+
+    bool isOpen() const { return mapping_ != nullptr; }
+
+    void append(double timestamp, std::span<const double> values) {
+        if (!mapping_ || full_) return;
+        assert(values.size() + 1 == recordSize_ / sizeof(double));
+
+        size_t offset = RECORDER_HISTORY_HEADER_SIZE + recordsCount_ * recordSize_;
+        if (offset + recordSize_ > fileSize_.load(std::memory_order_acquire)) {
+            // The ahead thread failed to grow the file, or fell a whole grow step behind.
+            fprintf(stderr, "%s: history stopped after %llu records, the file could not be grown\n",
+                    path_.c_str(), (unsigned long long) recordsCount_);
+            full_ = true;
+            return;
+        }
+
+        double *record = (double *) (mapping_ + offset);
+        record[0] = timestamp;
+        memcpy(record + 1, values.data(), values.size_bytes());
+
+        header()->recordsCount = ++recordsCount_;
+        writeOffset_.store(offset + recordSize_, std::memory_order_relaxed);
+    }
+
+    // Streams a history file to CSV without loading it into memory.
+    static bool exportCSV(const char *historyPath, const char *csvPath) {
+        int fd = ::open(historyPath, O_RDONLY);
+        if (fd < 0) {
+            perror(historyPath);
+            return false;
+        }
+
+        struct stat st = {};
+        if (fstat(fd, &st) != 0 || (size_t) st.st_size < RECORDER_HISTORY_HEADER_SIZE) {
+            fprintf(stderr, "%s: not a recorder history file\n", historyPath);
+            ::close(fd);
+            return false;
+        }
+
+        void *mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (mapping == MAP_FAILED) {
+            perror("RecorderHistoryFile mmap");
+            return false;
+        }
+
+        const RecorderHistoryHeader *hdr = (const RecorderHistoryHeader *) mapping;
+        bool valid = !memcmp(hdr->magic, RECORDER_HISTORY_MAGIC, sizeof(hdr->magic)) &&
+                     hdr->version == RECORDER_HISTORY_VERSION &&
+                     hdr->channelsCount <= RECORDER_HISTORY_MAX_CHANNELS &&
+                     hdr->recordSize == (hdr->channelsCount + 1) * sizeof(double) &&
+                     RECORDER_HISTORY_HEADER_SIZE + hdr->recordsCount * hdr->recordSize <= (size_t) st.st_size;
+
+        FILE *csv = (valid ? fopen(csvPath, "w") : nullptr);
+        if (!valid) fprintf(stderr, "%s: not a recorder history file\n", historyPath);
+        else if (!csv) perror(csvPath);
+
+        if (csv) {
+            fprintf(csv, "timestamp");
+            for (uint32_t i = 0; i < hdr->channelsCount; i++) {
+                fprintf(csv, ",%.*s", (int) RECORDER_HISTORY_NAME_LEN, hdr->channelNames[i]);
+            }
+            fprintf(csv, "\n");
+
+            const char *records = (const char *) mapping + RECORDER_HISTORY_HEADER_SIZE;
+            for (uint64_t i = 0; i < hdr->recordsCount; i++) {
+                const double *record = (const double *) (records + i * hdr->recordSize);
+
+                fprintf(csv, "%.17g", record[0]);
+                for (uint32_t ch = 0; ch < hdr->channelsCount; ch++) fprintf(csv, ",%.17g", record[ch + 1]);
+                fprintf(csv, "\n");
+            }
+            fclose(csv);
+        }
+
+        munmap(mapping, st.st_size);
+        return csv != nullptr;
+    }
+};
+
+#endif // RECORDER_HISTORY_H
@@ -0,0 +1,50 @@
+#ifndef RENDER_RESOURCES_H
+#define RENDER_RESOURCES_H
+
+#include <algorithm>
+#include <vector>
+
+#include "MyGUI.h"
+
+// Base of everything that keeps textures of the UI renderer between frames.
+// releaseTextures() destroys them; the owner recreates and redraws them on
+// its next draw. It is called on render target and device resets, which
+// lose texture contents, and by releaseRenderResources(), which whoever
+// destroys the renderer must call first.
+class RenderResource {
+    static std::vector<RenderResource *> &resources() {
+        static std::vector<RenderResource *> resources;
+        return resources;
+    }
+
+    static int onRenderReset(void *, SDL_Event *event) {
+        if (event->type == SDL_RENDER_TARGETS_RESET || event->type == SDL_RENDER_DEVICE_RESET) releaseAll();
+        return 0;
+    }
+
+public:
+    RenderResource() {
+        if (resources().empty()) SDL_AddEventWatch(onRenderReset, nullptr);
+        resources().push_back(this);
+    }
+
+    RenderResource(const RenderResource &) = delete;
+    RenderResource &operator=(const RenderResource &) = delete;
+
+    virtual ~RenderResource() {
+        std::vector<RenderResource *> &all = resources();
+        all.erase(std::find(all.begin(), all.end(), this));
+        if (all.empty()) SDL_DelEventWatch(onRenderReset, nullptr);
+    }
+
+    // Must be called while the renderer the textures belong to is alive.
+    virtual void releaseTextures() = 0;
+
+    static void releaseAll() {
+        for (RenderResource *resource : resources()) resource->releaseTextures();
+    }
+};
+
+inline void releaseRenderResources() { RenderResource::releaseAll(); }
+
+#endif // RENDER_RESOURCES_H
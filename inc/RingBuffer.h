@@ -0,0 +1,105 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <algorithm>
+#include <cassert>
+#include <compare>
+#include <cstddef>
+#include <iterator>
+#include <span>
+#include <vector>
+
+// Fixed-capacity FIFO over contiguous storage. Pushing into a full buffer
+// overwrites the oldest element, so both append and eviction are O(1).
+template <typename T>
+class RingBuffer {
+    std::vector<T> data_;
+    size_t head_ = 0;
+    size_t size_ = 0;
+
+public:
+    class const_iterator {
+        const RingBuffer *buffer_ = nullptr;
+        size_t idx_ = 0;
+
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T *;
+        using reference = const T &;
+
+        const_iterator() = default;
+        const_iterator(const RingBuffer *buffer, size_t idx): buffer_(buffer), idx_(idx) {}
+
+        reference operator*() const { return (*buffer_)[idx_]; }
+        pointer operator->() const { return &(*buffer_)[idx_]; }
+        reference operator[](difference_type n) const { return (*buffer_)[idx_ + n]; }
+
+        const_iterator &operator++() { idx_++; return *this; }
+        const_iterator operator++(int) { const_iterator prev = *this; idx_++; return prev; }
+        const_iterator &operator--() { idx_--; return *this; }
+        const_iterator operator--(int) { const_iterator prev = *this; idx_--; return prev; }
+        const_iterator &operator+=(difference_type n) { idx_ += n; return *this; }
+        const_iterator &operator-=(difference_type n) { idx_ -= n; return *this; }
+        const_iterator operator+(difference_type n) const { return {buffer_, idx_ + n}; }
+        const_iterator operator-(difference_type n) const { return {buffer_, idx_ - n}; }
+        friend const_iterator operator+(difference_type n, const const_iterator &it) { return it + n; }
+        difference_type operator-(const const_iterator &other) const { return (difference_type) idx_ - (difference_type) other.idx_; }
+
+        bool operator==(const const_iterator &other) const { return idx_ == other.idx_; }
+        auto operator<=>(const const_iterator &other) const { return idx_ <=> other.idx_; }
+    };
+
+    explicit RingBuffer(size_t capacity): data_(capacity) { assert(capacity > 0); }
+
+    size_t capacity() const { return data_.size(); }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    bool full() const { return size_ == data_.size(); }
+
+    const T &operator[](size_t idx) const {
+        assert(idx < size_);
+        size_t pos = head_ + idx;
+        return data_[pos < data_.size() ? pos : pos - data_.size()];
+    }
+
+    const T &front() const { return (*this)[0]; }
+    const T &back() const { return (*this)[size_ - 1]; }
+
+    void push_back(const T &value) {
+        size_t tail = head_ + size_;
+        if (tail >= data_.size()) tail -= data_.size();
+
+        data_[tail] = value;
+        if (full()) head_ = (head_ + 1 == data_.size() ? 0 : head_ + 1);
+        else        size_++;
+    }
+
+    void pop_front() {
+        assert(size_ > 0);
+        head_ = (head_ + 1 == data_.size() ? 0 : head_ + 1);
+        size_--;
+    }
+
+    void clear() {
+        head_ = 0;
+        size_ = 0;
+    }
+
+    const_iterator begin() const { return {this, 0}; }
+    const_iterator end() const { return {this, size_}; }
+
+    // The stored elements in order, as at most two contiguous runs.
+    std::span<const T> firstSegment() const {
+        size_t len = std::min(size_, data_.size() - head_);
+        return {data_.data() + head_, len};
+    }
+
+    std::span<const T> secondSegment() const {
+        size_t len = size_ - firstSegment().size();
+        return {data_.data(), len};
+    }
+};
+
+#endif // RING_BUFFER_H
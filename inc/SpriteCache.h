@@ -0,0 +1,178 @@
+#ifndef SPRITE_CACHE_H
+#define SPRITE_CACHE_H
+
+#include <unordered_map>
+#include <vector>
+
+#include "MyGUI.h"
+#include "RenderResources.h"
+#include "SDL2/SDL2_gfxPrimitives.h"
+
+const int SPRITE_ATLAS_SIZE = 512;
+const int SPRITE_ATLAS_PADDING = 1;
+
+enum class SpriteShape : Uint8 {
+    CIRCLE,
+    SQUARE
+};
+
+// Circles are keyed by radius, squares by side length.
+struct SpriteKey {
+    SpriteShape shape;
+    int size;
+    SDL_Color color;
+
+    Uint64 hash() const {
+        return ((Uint64) shape << 56) | ((Uint64) (size & 0xFFFFFF) << 32) | SDL2gfxColorToUint32(color);
+    }
+
+    int pixelSize() const { return (shape == SpriteShape::CIRCLE ? 2 * size + 1 : size); }
+};
+
+// Rasterizes each (shape, size, color) once into a shared atlas texture bound
+// to one renderer. Whenever the atlas is cleared (it filled up, the renderer
+// changed or was reset) generation() changes, and source rects fetched
+// earlier must be fetched again.
+class SpriteCache : public RenderResource {
+    SDL_Renderer *renderer_ = nullptr;
+    SDL_Texture *atlas_ = nullptr;
+    unsigned long long generation_ = 0;
+
+    std::unordered_map<Uint64, SDL_Rect> sprites_ = {};
+    std::vector<SpriteKey> requested_ = {};
+
+    int shelfX_ = 0;
+    int shelfY_ = 0;
+    int shelfHeight_ = 0;
+
+private:
+    void reset() {
+        if (!sprites_.empty()) generation_++;
+        sprites_.clear();
+        shelfX_ = shelfY_ = shelfHeight_ = 0;
+    }
+
+    bool allocateSlot(int width, int height, SDL_Rect &slot) {
+        if (width > SPRITE_ATLAS_SIZE || height > SPRITE_ATLAS_SIZE) return false;
+
+        if (shelfX_ + width > SPRITE_ATLAS_SIZE) {
+            shelfX_ = 0;
+            shelfY_ += shelfHeight_ + SPRITE_ATLAS_PADDING;
+            shelfHeight_ = 0;
+        }
+        if (shelfY_ + height > SPRITE_ATLAS_SIZE) return false;
+
+        slot = {shelfX_, shelfY_, width, height};
+        shelfX_ += width + SPRITE_ATLAS_PADDING;
+        shelfHeight_ = std::max(shelfHeight_, height);
+        return true;
+    }
+
+    void createAtlas() {
+        atlas_ = SDL_CreateTexture(renderer_, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, SPRITE_ATLAS_SIZE, SPRITE_ATLAS_SIZE);
+        if (!atlas_) {
+            SDL_Log("SpriteCache atlas: %s", SDL_GetError());
+            return;
+        }
+        SDL_SetTextureBlendMode(atlas_, SDL_BLENDMODE_BLEND);
+    }
+
+    void clearAtlas() {
+        SDL_Texture* prevTarget = SDL_GetRenderTarget(renderer_);
+        SDL_SetRenderTarget(renderer_, atlas_);
+        SDL_SetRenderDrawColor(renderer_, 0, 0, 0, 0);
+        SDL_RenderClear(renderer_);
+        SDL_SetRenderTarget(renderer_, prevTarget);
+    }
+
+    const SDL_Rect *rasterize(const SpriteKey &key) {
+        assert(renderer_);
+        if (!atlas_) return nullptr;
+
+        SDL_Rect slot = {};
+        if (!allocateSlot(key.pixelSize(), key.pixelSize(), slot)) {
+            // The atlas is full: start over, the live sprites will be requested again.
+            reset();
+            clearAtlas();
+            if (!allocateSlot(key.pixelSize(), key.pixelSize(), slot)) return nullptr;
+        }
+
+        RendererGuard rendererGuard(renderer_);
+        SDL_Texture* prevTarget = SDL_GetRenderTarget(renderer_);
+        SDL_SetRenderTarget(renderer_, atlas_);
+
+        switch (key.shape) {
+            case SpriteShape::CIRCLE:
+                filledCircleColor(renderer_, (Sint16) (slot.x + key.size), (Sint16) (slot.y + key.size), (Sint16) key.size, SDL2gfxColorToUint32(key.color));
+                break;
+            case SpriteShape::SQUARE:
+                SDL_SetRenderDrawColor(renderer_, key.color.r, key.color.g, key.color.b, key.color.a);
+                SDL_RenderFillRect(renderer_, &slot);
+                break;
+            default:
+                assert(0 && "SpriteCache rasterize() : unknown sprite shape");
+                break;
+        }
+
+        SDL_SetRenderTarget(renderer_, prevTarget);
+
+        return &(sprites_[key.hash()] = slot);
+    }
+
+public:
+    SpriteCache() = default;
+
+    // Must be called with the renderer used for drawing before sprites are
+    // fetched from it; rasterizes everything queued by request().
+    void bind(SDL_Renderer *renderer) {
+        assert(renderer);
+
+        if (renderer != renderer_) {
+            invalidate();
+            renderer_ = renderer;
+        }
+        if (!atlas_) {
+            createAtlas();
+            clearAtlas();
+        }
+
+        for (const SpriteKey &key : requested_) {
+            if (!find(key)) rasterize(key);
+        }
+        requested_.clear();
+    }
+
+    // Must be called while the bound renderer is still alive.
+    void invalidate() {
+        if (atlas_) SDL_DestroyTexture(atlas_);
+        atlas_ = nullptr;
+        renderer_ = nullptr;
+        reset();
+    }
+
+    void releaseTextures() override { invalidate(); }
+
+    unsigned long long generation() const { return generation_; }
+
+    const SDL_Rect *find(const SpriteKey &key) const {
+        auto it = sprites_.find(key.hash());
+        return (it == sprites_.end() ? nullptr : &it->second);
+    }
+
+    // Queues a sprite to be rasterized on the next bind().
+    void request(const SpriteKey &key) {
+        for (const SpriteKey &requested : requested_) {
+            if (requested.hash() == key.hash()) return;
+        }
+        requested_.push_back(key);
+    }
+
+    SDL_Texture *texture() const { return atlas_; }
+};
+
+inline SpriteCache &shapeSpriteCache() {
+    static SpriteCache cache;
+    return cache;
+}
+
+#endif // SPRITE_CACHE_H
@@ -0,0 +1,457 @@
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ReactorSimulation.h"
+
+const char TRAJECTORY_MAGIC[4] = {'R', 'T', 'R', 'J'};
+const uint32_t TRAJECTORY_VERSION = 1;
+const uint32_t TRAJECTORY_POSITION_SCALE = 64;    // positions are stored in 1/64 px
+const uint32_t TRAJECTORY_KEYFRAME_INTERVAL = 250;
+const size_t TRAJECTORY_QUEUE_CAPACITY = 64;
+
+// File layout (native little-endian): the header, then frames. Each frame is
+// a TrajectoryFrameHeader followed by payloadSize bytes of LEB128 varints.
+// Keyframes hold, per molecule, zigzag x and y, the size and the type;
+// delta frames hold only zigzag differences of x and y against the previous
+// frame, molecule by molecule in the same order.
+struct TrajectoryHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t positionScale;
+    uint32_t keyframeInterval;
+    uint32_t stepDelayMS;
+    uint32_t reserved;
+};
+
+struct TrajectoryFrameHeader {
+    uint64_t step;
+    double summaryEnergy;
+    double wallsEnergy[REACTOR_WALLS_COUNT];
+    uint32_t payloadSize;
+    uint32_t moleculesCount;
+    int32_t circlitCount;
+    int32_t quadritCount;
+    uint32_t keyframe;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(TrajectoryHeader) == 24);
+static_assert(sizeof(TrajectoryFrameHeader) == 72);
+
+inline void trajectoryPutVarint(std::vector<uint8_t> &out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back((uint8_t) (value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((uint8_t) value);
+}
+
+inline void trajectoryPutSigned(std::vector<uint8_t> &out, int64_t value) {
+    trajectoryPutVarint(out, ((uint64_t) value << 1) ^ (uint64_t) (value >> 63));
+}
+
+inline bool trajectoryGetVarint(const uint8_t *&cur, const uint8_t *end, uint64_t &value) {
+    value = 0;
+    for (int shift = 0; cur < end && shift < 64; shift += 7) {
+        uint8_t byte = *cur++;
+        value |= (uint64_t) (byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+inline bool trajectoryGetSigned(const uint8_t *&cur, const uint8_t *end, int64_t &value) {
+    uint64_t zigzag = 0;
+    if (!trajectoryGetVarint(cur, end, zigzag)) return false;
+
+    value = (int64_t) (zigzag >> 1) ^ -(int64_t) (zigzag & 1);
+    return true;
+}
+
+// Encodes published snapshots on the simulation thread and writes them from
+// a background thread. When the queue is full the frame is dropped and the
+// next one is forced to be a keyframe, so the simulation never waits on disk.
+class TrajectoryWriter {
+    FILE *file_ = nullptr;
+    std::thread thread_;
+
+    std::mutex queueMutex_;
+    std::condition_variable queueCondition_;
+    std::deque<std::vector<uint8_t>> queue_ = {};
+    std::vector<std::vector<uint8_t>> freeBuffers_ = {};
+    bool stopping_ = false;
+
+    // Encoder state, producer thread only.
+    std::vector<int64_t> prevPositions_ = {};
+    std::vector<uint64_t> prevShapes_ = {};
+    uint32_t sinceKeyframe_ = 0;
+    bool forceKeyframe_ = true;
+    unsigned long long droppedFrames_ = 0;
+
+private:
+    void run() {
+        std::unique_lock<std::mutex> lock(queueMutex_);
+
+        while (true) {
+            queueCondition_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+            if (queue_.empty()) return;
+
+            std::vector<uint8_t> frame = std::move(queue_.front());
+            queue_.pop_front();
+
+            lock.unlock();
+            if (fwrite(frame.data(), 1, frame.size(), file_) != frame.size()) perror("TrajectoryWriter fwrite");
+            lock.lock();
+
+            freeBuffers_.push_back(std::move(frame));
+        }
+    }
+
+    static uint64_t shapeOf(const MoleculeSnapshot &molecule) {
+        return ((uint64_t) std::llround(molecule.size * TRAJECTORY_POSITION_SCALE) << 8) | (uint64_t) molecule.type;
+    }
+
+    bool needsKeyframe(const ReactorSnapshot &snapshot) const {
+        if (forceKeyframe_ || sinceKeyframe_ >= TRAJECTORY_KEYFRAME_INTERVAL) return true;
+        if (snapshot.molecules.size() != prevShapes_.size()) return true;
+
+        for (size_t i = 0; i < snapshot.molecules.size(); i++) {
+            if (shapeOf(snapshot.molecules[i]) != prevShapes_[i]) return true;
+        }
+        return false;
+    }
+
+    void encode(const ReactorSnapshot &snapshot, std::vector<uint8_t> &out) {
+        bool keyframe = needsKeyframe(snapshot);
+
+        out.resize(sizeof(TrajectoryFrameHeader));
+        prevPositions_.resize(snapshot.molecules.size() * 2);
+        prevShapes_.resize(snapshot.molecules.size());
+
+        for (size_t i = 0; i < snapshot.molecules.size(); i++) {
+            const MoleculeSnapshot &molecule = snapshot.molecules[i];
+            int64_t x = std::llround(molecule.x * TRAJECTORY_POSITION_SCALE);
+            int64_t y = std::llround(molecule.y * TRAJECTORY_POSITION_SCALE);
+
+            if (keyframe) {
+                trajectoryPutSigned(out, x);
+                trajectoryPutSigned(out, y);
+                trajectoryPutVarint(out, shapeOf(molecule));
+            } else {
+                trajectoryPutSigned(out, x - prevPositions_[2 * i]);
+                trajectoryPutSigned(out, y - prevPositions_[2 * i + 1]);
+            }
+
+            prevPositions_[2 * i] = x;
+            prevPositions_[2 * i + 1] = y;
+            prevShapes_[i] = shapeOf(molecule);
+        }
+
+        TrajectoryFrameHeader header = {};
+        header.step = snapshot.step;
+        header.summaryEnergy = snapshot.summaryEnergy;
+        for (int i = 0; i < REACTOR_WALLS_COUNT; i++) header.wallsEnergy[i] = snapshot.wallsEnergy[i];
+        header.payloadSize = (uint32_t) (out.size() - sizeof(TrajectoryFrameHeader));
+        header.moleculesCount = (uint32_t) snapshot.molecules.size();
+        header.circlitCount = snapshot.circlitCount;
+        header.quadritCount = snapshot.quadritCount;
+        header.keyframe = keyframe;
+        memcpy(out.data(), &header, sizeof(header));
+
+        sinceKeyframe_ = (keyframe ? 1 : sinceKeyframe_ + 1);
+        forceKeyframe_ = false;
+    }
+
+public:
+    TrajectoryWriter() = default;
+    TrajectoryWriter(const TrajectoryWriter &) = delete;
+    TrajectoryWriter &operator=(const TrajectoryWriter &) = delete;
+
+    ~TrajectoryWriter() { close(); }
+
+    bool open(const char *path, int stepDelayMS) {
+        assert(path);
+        close();
+
+        file_ = fopen(path, "wb");
+        if (!file_) {
+            perror(path);
+            return false;
+        }
+
+        TrajectoryHeader header = {};
+        memcpy(header.magic, TRAJECTORY_MAGIC, sizeof(header.magic));
+        header.version = TRAJECTORY_VERSION;
+        header.positionScale = TRAJECTORY_POSITION_SCALE;
+        header.keyframeInterval = TRAJECTORY_KEYFRAME_INTERVAL;
+        header.stepDelayMS = (uint32_t) stepDelayMS;
+        if (fwrite(&header, sizeof(header), 1, file_) != 1 || fflush(file_) != 0) {
+            perror(path);
+            fclose(file_);
+            file_ = nullptr;
+            return false;
+        }
+
+        stopping_ = false;
+        forceKeyframe_ = true;
+        droppedFrames_ = 0;
+        thread_ = std::thread([this] { run(); });
+        return true;
+    }
+
+    // Flushes the queued frames and closes the file.
+    void close() {
+        if (!file_) return;
+
+        {
+            std::lock_guard<std::mutex> lock(queueMutex_);
+            stopping_ = true;
+        }
+        queueCondition_.notify_one();
+        if (thread_.joinable()) thread_.join();
+
+        fclose(file_);
+        file_ = nullptr;
+
+        if (droppedFrames_) fprintf(stderr, "TrajectoryWriter: %llu frames dropped, writer fell behind\n", droppedFrames_);
+    }
+
+    void push(const ReactorSnapshot &snapshot) {
+        if (!file_) return;
+
+        std::vector<uint8_t> frame;
+        {
+            std::lock_guard<std::mutex> lock(queueMutex_);
+            if (!freeBuffers_.empty()) {
+                frame = std::move(freeBuffers_.back());
+                freeBuffers_.pop_back();
+            }
+        }
+
+        encode(snapshot, frame);
+
+        {
+            std::lock_guard<std::mutex> lock(queueMutex_);
+            if (queue_.size() >= TRAJECTORY_QUEUE_CAPACITY) {
+                freeBuffers_.push_back(std::move(frame));
+                forceKeyframe_ = true;
+                droppedFrames_++;
+                return;
+            }
+            queue_.push_back(std::move(frame));
+        }
+        queueCondition_.notify_one();
+    }
+};
+
+// Replay source over a memory-mapped trajectory file. Frames are indexed once
+// on open; seek() decodes forward from the nearest keyframe at or before the
+// target, next() decodes a single frame; either leaves the shown frame as it
+// was if decoding fails. A truncated tail, e.g. after a crash, is ignored.
+class TrajectoryReader {
+    const uint8_t *mapping_ = nullptr;
+    size_t mappingSize_ = 0;
+    TrajectoryHeader header_ = {};
+
+    std::vector<size_t> frameOffsets_ = {};
+    std::vector<size_t> keyframes_ = {};
+
+    size_t frame_ = 0;
+    std::vector<int64_t> positions_ = {};
+    ReactorSnapshot snapshot_ = {};
+
+    // Scratch state frames are decoded into before they are shown.
+    std::vector<int64_t> decodedPositions_ = {};
+    ReactorSnapshot decodedSnapshot_ = {};
+
+private:
+    TrajectoryFrameHeader frameHeader(size_t frame) const {
+        TrajectoryFrameHeader header = {};
+        memcpy(&header, mapping_ + frameOffsets_[frame], sizeof(header));
+        return header;
+    }
+
+    // Decodes `frame` over the state of `prevFrame` held in snapshot and
+    // positions. Both are left half-updated on failure.
+    bool decode(size_t frame, size_t prevFrame, ReactorSnapshot &snapshot, std::vector<int64_t> &positions) const {
+        TrajectoryFrameHeader header = frameHeader(frame);
+        const uint8_t *cur = mapping_ + frameOffsets_[frame] + sizeof(header);
+        const uint8_t *end = cur + header.payloadSize;
+
+        if (!header.keyframe && header.moleculesCount * 2 != positions.size()) return false;
+
+        // Molecules move smoothly from the previous frame only when playing forward.
+        bool continuous = (frame == prevFrame + 1 && header.moleculesCount == snapshot.molecules.size());
+        snapshot.molecules.resize(header.moleculesCount);
+        positions.resize(header.moleculesCount * 2);
+
+        const double scale = header_.positionScale;
+        for (size_t i = 0; i < header.moleculesCount; i++) {
+            MoleculeSnapshot &molecule = snapshot.molecules[i];
+            int64_t x = 0, y = 0;
+
+            if (!trajectoryGetSigned(cur, end, x) || !trajectoryGetSigned(cur, end, y)) return false;
+
+            if (header.keyframe) {
+                uint64_t shape = 0;
+                if (!trajectoryGetVarint(cur, end, shape)) return false;
+
+                molecule.size = (double) (shape >> 8) / scale;
+                molecule.type = (MoleculeTypes) (shape & 0xFF);
+            } else {
+                x += positions[2 * i];
+                y += positions[2 * i + 1];
+            }
+
+            positions[2 * i] = x;
+            positions[2 * i + 1] = y;
+
+            molecule.prevX = (continuous ? molecule.x : x / scale);
+            molecule.prevY = (continuous ? molecule.y : y / scale);
+            molecule.x = x / scale;
+            molecule.y = y / scale;
+        }
+
+        for (int i = 0; i < REACTOR_WALLS_COUNT; i++) snapshot.wallsEnergy[i] = header.wallsEnergy[i];
+        snapshot.summaryEnergy = header.summaryEnergy;
+        snapshot.circlitCount = header.circlitCount;
+        snapshot.quadritCount = header.quadritCount;
+        snapshot.step = header.step;
+        snapshot.time = std::chrono::steady_clock::now();
+        return true;
+    }
+
+    // Decodes frames [first, last] in order and shows the last one. The shown
+    // frame is replaced only if all of them decode.
+    bool decodeRange(size_t first, size_t last) {
+        decodedSnapshot_ = snapshot_;
+        decodedPositions_ = positions_;
+
+        for (size_t cur = first, prev = frame_; cur <= last; prev = cur++) {
+            if (!decode(cur, prev, decodedSnapshot_, decodedPositions_)) return false;
+        }
+
+        std::swap(snapshot_, decodedSnapshot_);
+        std::swap(positions_, decodedPositions_);
+        frame_ = last;
+        return true;
+    }
+
+public:
+    TrajectoryReader() = default;
+    TrajectoryReader(const TrajectoryReader &) = delete;
+    TrajectoryReader &operator=(const TrajectoryReader &) = delete;
+
+    ~TrajectoryReader() { close(); }
+
+    bool open(const char *path) {
+        assert(path);
+        close();
+
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) {
+            perror(path);
+            return false;
+        }
+
+        struct stat st = {};
+        if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(TrajectoryHeader)) {
+            fprintf(stderr, "%s: not a trajectory file\n", path);
+            ::close(fd);
+            return false;
+        }
+
+        void *mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (mapping == MAP_FAILED) {
+            perror("TrajectoryReader mmap");
+            return false;
+        }
+        mapping_ = (const uint8_t *) mapping;
+        mappingSize_ = st.st_size;
+
+        memcpy(&header_, mapping_, sizeof(header_));
+        if (memcmp(header_.magic, TRAJECTORY_MAGIC, sizeof(header_.magic)) || header_.version != TRAJECTORY_VERSION ||
+            header_.positionScale == 0) {
+            fprintf(stderr, "%s: not a trajectory file\n", path);
+            close();
+            return false;
+        }
+
+        for (size_t offset = sizeof(TrajectoryHeader); offset + sizeof(TrajectoryFrameHeader) <= mappingSize_;) {
+            TrajectoryFrameHeader header = {};
+            memcpy(&header, mapping_ + offset, sizeof(header));
+            if (offset + sizeof(header) + header.payloadSize > mappingSize_) break;
+
+            if (header.keyframe) keyframes_.push_back(frameOffsets_.size());
+            frameOffsets_.push_back(offset);
+            offset += sizeof(header) + header.payloadSize;
+        }
+
+        if (keyframes_.empty() || keyframes_[0] != 0 || !decodeRange(0, 0)) {
+            fprintf(stderr, "%s: trajectory has no readable frames\n", path);
+            close();
+            return false;
+        }
+
+        return true;
+    }
+
+    void close() {
+        if (mapping_) munmap((void *) mapping_, mappingSize_);
+
+        mapping_ = nullptr;
+        mappingSize_ = 0;
+        frameOffsets_.clear();
+        keyframes_.clear();
+        frame_ = 0;
+        positions_.clear();
+        snapshot_ = {};
+    }
+
+    bool isOpen() const { return mapping_ != nullptr; }
+
+    size_t framesCount() const { return frameOffsets_.size(); }
+    size_t keyframesCount() const { return keyframes_.size(); }
+    size_t frame() const { return frame_; }
+    int stepDelayMS() const { return (int) header_.stepDelayMS; }
+
+    const ReactorSnapshot &snapshot() const { return snapshot_; }
+
+    bool next() {
+        if (!mapping_ || frame_ + 1 >= frameOffsets_.size()) return false;
+        return decodeRange(frame_ + 1, frame_ + 1);
+    }
+
+    bool seek(size_t frame) {
+        if (!mapping_ || frame >= frameOffsets_.size()) return false;
+
+        auto keyframe = std::upper_bound(keyframes_.begin(), keyframes_.end(), frame) - 1;
+        return decodeRange(*keyframe, frame);
+    }
+
+    bool seekKeyframe(size_t keyframe) {
+        if (keyframe >= keyframes_.size()) return false;
+        return seek(keyframes_[keyframe]);
+    }
+};
+
+#endif // TRAJECTORY_H
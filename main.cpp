@@ -1,3 +1,7 @@
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <string>
 
 #include "MyGUI.h"
 #include "gm_primitives.hpp"
@@ -6,8 +10,20 @@
 #include "Plots.h"
 #include "ClockWidget.h"
 #include "ScrollBar.h"
+#include "ReadoutWidget.h"
+#include "Profiler.h"
+#include "ProfilerOverlay.h"
+#include "RenderResources.h"
+
+#ifdef REACTOR_PROFILE
+#include <csignal>
+#endif
 
 const SDL_Color ENERGY_COLOR = {0, 200, 255, 255};
+const SDL_Color LEFT_WALL_ENERGY_COLOR = {255, 140, 0, 255};
+const SDL_Color RIGHT_WALL_ENERGY_COLOR = {200, 0, 200, 255};
+const SDL_Color TOP_WALL_ENERGY_COLOR = {0, 160, 0, 255};
+const SDL_Color BOTTOM_WALL_ENERGY_COLOR = {120, 120, 120, 255};
 
 const int APP_BORDER_SZ = 10;
 const gm_dot<int, 2> MAIN_WINDOW_SZ = {800, 600};
@@ -15,10 +31,15 @@ const gm_dot<int, 2> REACTOR_GUI_SZ = {300, 500};
 const gm_dot<int, 2> PLOT_SZ = {(REACTOR_GUI_SZ.y - APP_BORDER_SZ) / 2, (REACTOR_GUI_SZ.y - APP_BORDER_SZ) / 2};
 const int CLOCK_WINDOW_LENGTH = 200;
 const gm_dot<int, 2> SCROLL_BAR_SZ = {200, 40};
+const gm_dot<int, 2> READOUT_WINDOW_SZ = {200, 100};
+const gm_dot<int, 2> PROFILER_OVERLAY_SZ = {200, 240};
 const double MOLECULE_RECORDER_START_SCALE = 30;
 const double START_ENERGY_YSCALE = 1.0 / 100000;
 
 const char FONT_PATH[] = "fonts/Roboto/RobotoFont.ttf";
+const char MOLECULES_HISTORY_NAME[] = "molecules_history";
+const char ENERGY_HISTORY_NAME[] = "energy_history";
+const char PROFILE_TRACE_PATH[] = "reactor_trace.json";
 
 const ReactorButtonTexturePack reactorButtonTexturePack = 
 {
@@ -36,46 +57,139 @@ const ReactorButtonTexturePack reactorButtonTexturePack =
     .explodeReactorBtnPath      = {"images/reactorButtonPanel/explode/unpressed.png", "images/reactorButtonPanel/explode/pressed.png"}
 };
 
-int main() {
+static void printUsage(const char *programName) {
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  --record-history DIR       spill recorder history to new files in DIR\n"
+        "  --record-trajectory PATH   write every simulation step to PATH\n"
+        "  --replay PATH              show a recorded trajectory instead of the live reactor\n",
+        programName);
+}
+
+// DIR/<name>_<local time>.rch, so each launch starts new files.
+static std::string historyPath(const char *dir, const char *name) {
+    char stamp[32] = "";
+    time_t now = time(nullptr);
+    strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", localtime(&now));
+
+    return std::string(dir) + "/" + name + "_" + stamp + ".rch";
+}
+
+int main(int argc, char *argv[]) {
+    const char *recordHistoryDir = nullptr;
+    const char *recordTrajectoryPath = nullptr;
+    const char *replayPath = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        const char *value = (i + 1 < argc ? argv[i + 1] : nullptr);
+
+        if      (!strcmp(argv[i], "--record-history") && value)    recordHistoryDir = value;
+        else if (!strcmp(argv[i], "--record-trajectory") && value) recordTrajectoryPath = value;
+        else if (!strcmp(argv[i], "--replay") && value)            replayPath = value;
+        else {
+            printUsage(argv[0]);
+            return 1;
+        }
+        i++;
+    }
+
     UIManager application(MAIN_WINDOW_SZ.x, MAIN_WINDOW_SZ.y);
 
     Container *mainWindow = new Container(MAIN_WINDOW_SZ.x - 2 * APP_BORDER_SZ, MAIN_WINDOW_SZ.y - 2 * APP_BORDER_SZ);
     application.setMainWidget(APP_BORDER_SZ, APP_BORDER_SZ, mainWindow);    
 
     ScrollRecorderWindow *moleculesRecorder = new ScrollRecorderWindow(PLOT_SZ.x, PLOT_SZ.y, MOLECULE_RECORDER_START_SCALE, false, mainWindow);
+    moleculesRecorder->addChannel("circlits", RED_SDL_COLOR);
+    moleculesRecorder->addChannel("quadrits", BLUE_SDL_COLOR);
+    moleculesRecorder->setDrawMode(RecorderDrawMode::LINES);
     mainWindow->addWidget(REACTOR_GUI_SZ.x + 2 * APP_BORDER_SZ, APP_BORDER_SZ, moleculesRecorder);
 
     RecorderWindow *energyRecorder = new RecorderWindow(PLOT_SZ.x, PLOT_SZ.y, START_ENERGY_YSCALE, true, mainWindow);
+    energyRecorder->addChannel("summary energy", ENERGY_COLOR);
+    energyRecorder->addChannel("left wall energy", LEFT_WALL_ENERGY_COLOR);
+    energyRecorder->addChannel("right wall energy", RIGHT_WALL_ENERGY_COLOR);
+    energyRecorder->addChannel("top wall energy", TOP_WALL_ENERGY_COLOR);
+    energyRecorder->addChannel("bottom wall energy", BOTTOM_WALL_ENERGY_COLOR);
+    energyRecorder->setDrawMode(RecorderDrawMode::LINES);
     mainWindow->addWidget(REACTOR_GUI_SZ.x + 2 * APP_BORDER_SZ, PLOT_SZ.y + 2 * APP_BORDER_SZ, energyRecorder);
 
-    ReactorGUI *reactorGUI = new ReactorGUI(REACTOR_GUI_SZ.x, REACTOR_GUI_SZ.y, reactorButtonTexturePack, nullptr, 40);
-    reactorGUI->setReactorOnUpdate(
-        [reactorGUI, moleculesRecorder, energyRecorder] {
-            int reactorCirclitCount = reactorGUI->getReactorCirclitCount();
-            int reactorQuadritCount = reactorGUI->getReactorQuadritCount();
-            double reactorEnergy = reactorGUI->getReactorSummaryEnergy();
+    if (recordHistoryDir) {
+        if (!moleculesRecorder->spillToFile(historyPath(recordHistoryDir, MOLECULES_HISTORY_NAME).c_str())) return 1;
+        if (!energyRecorder->spillToFile(historyPath(recordHistoryDir, ENERGY_HISTORY_NAME).c_str())) return 1;
+    }
 
-            moleculesRecorder->addPoint(reactorCirclitCount, RED_SDL_COLOR);
-            moleculesRecorder->addPoint(reactorQuadritCount, BLUE_SDL_COLOR);
-            moleculesRecorder->endRecord();
+    ReadoutWindow *readoutWindow = new ReadoutWindow(READOUT_WINDOW_SZ.x, READOUT_WINDOW_SZ.y, FONT_PATH, mainWindow);
+    size_t timeReadout      = readoutWindow->addReadout("time, s", WHITE_SDL_COLOR);
+    size_t circlitsReadout  = readoutWindow->addReadout("circlits", RED_SDL_COLOR);
+    size_t quadritsReadout  = readoutWindow->addReadout("quadrits", BLUE_SDL_COLOR);
+    size_t energyReadout    = readoutWindow->addReadout("summary energy", ENERGY_COLOR);
+    mainWindow->addWidget(3 * APP_BORDER_SZ + REACTOR_GUI_SZ.x + PLOT_SZ.x, 2 * APP_BORDER_SZ + CLOCK_WINDOW_LENGTH, readoutWindow);
 
-            energyRecorder->addPoint(reactorEnergy, ENERGY_COLOR);
-            energyRecorder->endRecord();
+    ReactorGUI *reactorGUI = new ReactorGUI(REACTOR_GUI_SZ.x, REACTOR_GUI_SZ.y, reactorButtonTexturePack, nullptr, 40);
+    reactorGUI->setReactorOnUpdate(
+        [reactorGUI, moleculesRecorder, energyRecorder, readoutWindow, timeReadout, circlitsReadout, quadritsReadout, energyReadout] {
+            double reactorTime = reactorGUI->getReactorTime();
+
+            readoutWindow->setValue(timeReadout, reactorTime);
+            readoutWindow->setValue(circlitsReadout, reactorGUI->getReactorCirclitCount());
+            readoutWindow->setValue(quadritsReadout, reactorGUI->getReactorQuadritCount());
+            readoutWindow->setValue(energyReadout, reactorGUI->getReactorSummaryEnergy());
+
+            moleculesRecorder->record(reactorTime, reactorGUI->getReactorCirclitCount(), reactorGUI->getReactorQuadritCount());
+
+            energyRecorder->record(reactorTime,
+                reactorGUI->getReactorSummaryEnergy(),
+                reactorGUI->getReactorWallEnergy(LEFT_WALL),
+                reactorGUI->getReactorWallEnergy(RIGHT_WALL),
+                reactorGUI->getReactorWallEnergy(TOP_WALL),
+                reactorGUI->getReactorWallEnergy(BOTTOM_WALL));
         }
     );
     mainWindow->addWidget(APP_BORDER_SZ, APP_BORDER_SZ, reactorGUI);
 
+    if (recordTrajectoryPath && !reactorGUI->recordTrajectory(recordTrajectoryPath)) return 1;
+    if (replayPath) {
+        if (!reactorGUI->replayTrajectory(replayPath)) return 1;
+
+        ScrollBar *replayScrollBar = new ScrollBar(SCROLL_BAR_SZ.x, SCROLL_BAR_SZ.y,
+            [reactorGUI](double fraction) { reactorGUI->seekReplay(fraction); }, true, mainWindow);
+        mainWindow->addWidget(APP_BORDER_SZ, 2 * APP_BORDER_SZ + REACTOR_GUI_SZ.y, replayScrollBar);
+    }
+
 
     ClockWindow *clockWindow = new ClockWindow(CLOCK_WINDOW_LENGTH, FONT_PATH, mainWindow);
     mainWindow->addWidget(3 * APP_BORDER_SZ + REACTOR_GUI_SZ.x + PLOT_SZ.x, APP_BORDER_SZ, clockWindow);
 
     
+#ifdef REACTOR_PROFILE
+    // kill -USR1 <pid> dumps the trace on the next tick.
+    std::signal(SIGUSR1, [](int) { Profiler::instance().requestDump(); });
+
+    ProfilerOverlay *profilerOverlay = new ProfilerOverlay(PROFILER_OVERLAY_SZ.x, PROFILER_OVERLAY_SZ.y, FONT_PATH, mainWindow);
+    mainWindow->addWidget(3 * APP_BORDER_SZ + REACTOR_GUI_SZ.x + PLOT_SZ.x, 3 * APP_BORDER_SZ + CLOCK_WINDOW_LENGTH + READOUT_WINDOW_SZ.y, profilerOverlay);
+
+    application.addUserEvent([profilerOverlay](int deltaMS) {
+        profilerOverlay->updateOverlay(deltaMS);
+        Profiler::instance().dumpIfRequested(PROFILE_TRACE_PATH);
+    });
+#endif
+
     application.addUserEvent([reactorGUI, clockWindow](int deltaMS) { 
+        PROFILE_FRAME();
+        PROFILE_SCOPE(PROFILE_FRAME_UPDATE_NAME);
         reactorGUI->updateReactor(deltaMS); 
         clockWindow->updateClock(deltaMS);
     });
     
+    PROFILE_THREAD_NAME("ui");
     application.run();
+    // The renderer is destroyed together with application, and the widgets
+    // owning textures are not guaranteed to go before it.
+    releaseRenderResources();
+
+#ifdef REACTOR_PROFILE
+    Profiler::instance().dumpChromeTrace(PROFILE_TRACE_PATH);
+#endif
 
     return 0;
 }